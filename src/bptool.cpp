@@ -0,0 +1,213 @@
+#include <boost/program_options.hpp>
+#include <stdio.h>
+#include <cstdlib>
+#include <climits>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include "pred.h"
+#include "brtrace.h"
+
+using namespace std;
+
+/*
+    Replays a branch trace recorded with simu -t against a list of
+    predictor configurations, one configuration per worker at a time.
+
+    bptool -t trace.bt GS:14 TN:10,10,12 TAGE:64,12 PERC:9,64
+*/
+
+typedef struct SweepConfig{
+    string spec;
+    Scheme scm;
+    int args[3];
+    int nargs;
+
+    /*results*/
+    long long condCnt;
+    long long condMiss;
+    long long jalrCnt;
+    long long jalrMiss;
+}SweepConfig;
+
+/*argument ranges as PfmConfig checks them*/
+static const struct{
+    const char *name;
+    Scheme scm;
+    int maxArgs;
+    int lo[3];
+    int hi[3];
+}schemeTable[] = {
+    {"AT", AlwaysTaken, 0, {0}, {0}},
+    {"ANT", AlwaysNotTaken, 0, {0}, {0}},
+    {"BI", Bimodal, 0, {0}, {0}},
+    {"SA", SelfAdj, 0, {0}, {0}},
+    {"GS", GShare, 1, {1}, {24}},                   /*history bits*/
+    {"TN", Tournament, 3, {1, 1, 1}, {24, 24, 24}}, /*local bits, local history bits, global bits*/
+    {"TAGE", Tage, 2, {4, 2}, {INT_MAX, TAGE_MAX_TABLES}},    /*budget KB, tagged tables*/
+    {"PERC", HashedPerc, 2, {1, 1}, {16, PERC_MAX_HIST}},     /*row bits, history length*/
+};
+
+static bool
+parseSpec(const string &spec, SweepConfig &c){
+    size_t colon = spec.find(':');
+    string name = spec.substr(0, colon);
+    int maxArgs = -1;
+    size_t k = 0;
+    for(size_t i = 0; i < sizeof(schemeTable) / sizeof(schemeTable[0]); i++)
+        if(name.compare(schemeTable[i].name) == 0){
+            c.scm = schemeTable[i].scm;
+            maxArgs = schemeTable[i].maxArgs;
+            k = i;
+        }
+    if(maxArgs < 0){
+        printf("unknown scheme in %s\n", spec.c_str());
+        return false;
+    }
+
+    c.spec = spec;
+    c.nargs = 0;
+    if(colon != string::npos){
+        const char *p = spec.c_str() + colon + 1;
+        while(*p != '\0'){
+            char *end;
+            long v = strtol(p, &end, 10);
+            if(end == p || c.nargs == maxArgs ||
+               v < schemeTable[k].lo[c.nargs] || v > schemeTable[k].hi[c.nargs]){
+                printf("bad parameters in %s\n", spec.c_str());
+                return false;
+            }
+            c.args[c.nargs ++] = (int)v;
+            p = (*end == ',') ? end + 1 : end;
+        }
+    }
+    c.condCnt = c.condMiss = c.jalrCnt = c.jalrMiss = 0;
+    return true;
+}
+
+static void
+configure(Predictor &p, const SweepConfig &c){
+    p.SetScheme(c.scm);
+    if(c.scm == GShare)
+        p.SetGShare(c.nargs > 0 ? c.args[0] : GSHARE_BITS);
+    if(c.scm == Tournament)
+        p.SetTournament(c.nargs > 0 ? c.args[0] : TOUR_LOCAL_BITS,
+                        c.nargs > 1 ? c.args[1] : TOUR_LOCALHIS_BITS,
+                        c.nargs > 2 ? c.args[2] : TOUR_GLOBAL_BITS);
+    if(c.scm == Tage)
+        p.SetTage(c.nargs > 0 ? c.args[0] : TAGE_BUDGET_KB,
+                  c.nargs > 1 ? c.args[1] : TAGE_TABLES);
+    if(c.scm == HashedPerc)
+        p.SetPerceptron(c.nargs > 0 ? c.args[0] : PERC_ROW_BITS,
+                        c.nargs > 1 ? c.args[1] : PERC_HIST);
+}
+
+/*
+    Every branch is predicted and resolved back to back, so there is no
+    wrong path and the speculative history never needs repair.
+*/
+static void
+replay(const vector<BranchRecord> &trace, SweepConfig &c){
+    Predictor *p = new Predictor();
+    configure(*p, c);
+
+    for(size_t i = 0; i < trace.size(); i++){
+        const BranchRecord &r = trace[i];
+        int64_t pc = r.pc;
+        int64_t retAddr = pc + ((r.flags & BR_COMPRESSED) ? 2 : 4);
+        bool taken = r.flags & BR_TAKEN;
+
+        if(r.kind == BrCond){
+            Prediction pred = p->predict(pc);
+            c.condCnt ++;
+            if(pred.taken != taken)
+                c.condMiss ++;
+            p->update(pc, taken, r.target, pred.meta);
+        }
+        else if(r.kind == BrJal)
+            p->predict(pc, BrJal, r.rd, r.rs1, retAddr);
+        else{
+            Prediction pred = p->predict(pc, BrJalr, r.rd, r.rs1, retAddr);
+            c.jalrCnt ++;
+            if(!pred.hasTarget || pred.target != (int64_t)r.target)
+                c.jalrMiss ++;
+            p->update(pc, true, r.target, pred.meta);
+        }
+    }
+    delete p;
+}
+
+int main(int argc, char **argv){
+
+    boost::program_options::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Print help message")
+        ("trace,t", boost::program_options::value<string>(), "branch trace recorded by simu -t")
+        ("jobs,j", boost::program_options::value<int>(), "worker threads, default one per host cpu")
+        ("config", boost::program_options::value<vector<string> >(),
+            "predictor configs AT ANT BI SA GS[:bits] TN[:l,lh,g] TAGE[:kb,tables] PERC[:rows,hist]")
+        ;
+    boost::program_options::positional_options_description pos;
+    pos.add("config", -1);
+
+    boost::program_options::variables_map vm;
+
+    try{
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                .options(desc).positional(pos).run(), vm);
+        boost::program_options::notify(vm);
+    }
+    catch (boost::exception& e) {
+        printf("parse command line exception!\n");
+        cout << desc << endl;
+        return 1;
+    }
+
+    if(vm.count("help") || !vm.count("trace") || !vm.count("config")){
+        cout << desc << endl;
+        return 0;
+    }
+
+    vector<string> specs = vm["config"].as<vector<string> >();
+    vector<SweepConfig> configs(specs.size());
+    for(size_t i = 0; i < specs.size(); i++)
+        if(!parseSpec(specs[i], configs[i]))
+            return 1;
+
+    vector<BranchRecord> trace;
+    uint64_t instrCnt = 0;
+    if(!LoadBranchTrace(vm["trace"].as<string>().c_str(), trace, instrCnt))
+        return 1;
+    printf("Trace: %zu branches, %llu instr\n", trace.size(), (unsigned long long)instrCnt);
+
+    int jobs = vm.count("jobs") ? vm["jobs"].as<int>() : (int)thread::hardware_concurrency();
+    if(jobs < 1)
+        jobs = 1;
+    if(jobs > (int)configs.size())
+        jobs = configs.size();
+
+    /*workers take the next unstarted config until none are left*/
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for(int i = 0; i < jobs; i++)
+        workers.push_back(thread([&](){
+            for(size_t k = next ++; k < configs.size(); k = next ++)
+                replay(trace, configs[k]);
+        }));
+    for(size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    double kilo = instrCnt > 0 ? instrCnt / 1000.0 : 1.0;
+    printf("%-20s %10s %8s %10s %10s\n", "config", "cond MPKI", "acc", "jalr MPKI", "MPKI");
+    for(size_t i = 0; i < configs.size(); i++){
+        SweepConfig &c = configs[i];
+        printf("%-20s %10.3f %8.4f %10.3f %10.3f\n", c.spec.c_str(),
+               c.condMiss / kilo,
+               c.condCnt > 0 ? 1.0 - (double)c.condMiss / c.condCnt : 0.0,
+               c.jalrMiss / kilo,
+               (c.condMiss + c.jalrMiss) / kilo);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "brtrace.h"
+#include "utils.h"
+
+BranchTraceWriter::BranchTraceWriter(){
+    f = NULL;
+    records = 0;
+}
+
+BranchTraceWriter::~BranchTraceWriter(){
+    if(f != NULL)
+        Close(0);
+}
+
+bool
+BranchTraceWriter::Open(const char *path){
+    ASSERT(f == NULL);
+    f = fopen(path, "wb");
+    if(f == NULL)
+        return false;
+    /*placeholder, filled in by Close()*/
+    BranchTraceHeader h = {BRTRACE_MAGIC, BRTRACE_VERSION, 0, 0};
+    fwrite(&h, sizeof(h), 1, f);
+    buf.reserve(BRTRACE_BUF);
+    records = 0;
+    return true;
+}
+
+void
+BranchTraceWriter::Record(BranchKind kind, uint64_t pc, uint64_t target, bool taken,
+                          int len, int rd, int rs1){
+    BranchRecord r;
+    r.pc = pc;
+    r.target = target;
+    r.kind = kind;
+    r.flags = (taken ? BR_TAKEN : 0) | (len == 2 ? BR_COMPRESSED : 0);
+    r.rd = rd;
+    r.rs1 = rs1;
+    buf.push_back(r);
+    if(buf.size() >= BRTRACE_BUF)
+        flush();
+}
+
+void
+BranchTraceWriter::flush(){
+    if(!buf.empty())
+        fwrite(&buf[0], sizeof(BranchRecord), buf.size(), f);
+    records += buf.size();
+    buf.clear();
+}
+
+void
+BranchTraceWriter::Close(uint64_t instrCnt){
+    if(f == NULL)
+        return;
+    flush();
+    BranchTraceHeader h = {BRTRACE_MAGIC, BRTRACE_VERSION, instrCnt, records};
+    fseek(f, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, f);
+    fclose(f);
+    f = NULL;
+}
+
+bool
+LoadBranchTrace(const char *path, std::vector<BranchRecord> &trace, uint64_t &instrCnt){
+    FILE *f = fopen(path, "rb");
+    if(f == NULL){
+        printf("Fail to open trace %s!\n", path);
+        return false;
+    }
+    BranchTraceHeader h;
+    if(fread(&h, sizeof(h), 1, f) != 1 || h.magic != BRTRACE_MAGIC ||
+       h.version != BRTRACE_VERSION){
+        printf("%s is not a branch trace!\n", path);
+        fclose(f);
+        return false;
+    }
+    trace.resize(h.records);
+    size_t n = h.records > 0 ? fread(&trace[0], sizeof(BranchRecord), h.records, f) : 0;
+    fclose(f);
+    if(n != h.records){
+        printf("%s is truncated (%zu of %llu records)!\n", path, n,
+               (unsigned long long)h.records);
+        trace.resize(n);
+    }
+    instrCnt = h.instrCnt;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef BRTRACE_H
+#define BRTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define BRTRACE_MAGIC 0x52544252    /*"RBTR"*/
+#define BRTRACE_VERSION 1
+#define BRTRACE_BUF 4096            //records buffered before a write
+
+enum BranchKind{
+    BrCond, BrJal, BrJalr
+};
+
+/*one resolved control transfer, 20 bytes on disk*/
+typedef struct __attribute__((packed)) BranchRecord{
+    uint64_t pc;
+    uint64_t target;    /*taken target*/
+    uint8_t kind;
+    uint8_t flags;      /*bit 0: taken, bit 1: 16-bit instr*/
+    uint8_t rd;         /*jal/jalr link registers, drive the RAS*/
+    uint8_t rs1;
+}BranchRecord;
+
+#define BR_TAKEN 0x1
+#define BR_COMPRESSED 0x2
+
+typedef struct BranchTraceHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t instrCnt;  /*instructions retired, for MPKI*/
+    uint64_t records;
+}BranchTraceHeader;
+
+/*
+ *Written by the simulator (-t), read back by bptool. The header is
+ *rewritten on Close() once the instruction count is known.
+ */
+class BranchTraceWriter{
+public:
+    BranchTraceWriter();
+    ~BranchTraceWriter();
+    bool Open(const char *path);
+    void Record(BranchKind kind, uint64_t pc, uint64_t target, bool taken,
+                int len, int rd, int rs1);
+    void Close(uint64_t instrCnt);
+
+private:
+    void flush();
+
+    FILE *f;
+    std::vector<BranchRecord> buf;
+    uint64_t records;
+};
+
+bool LoadBranchTrace(const char *path, std::vector<BranchRecord> &trace, uint64_t &instrCnt);
+
+#endif
@@ -16,6 +16,21 @@ void Cache::HandleRequest(uint64_t addr, int bytes, int read,
                           char *content, int &hit, int &time) {
 
     ASSERT(cache_content != NULL);
+    // A prefetch fill: done like a read, the levels below told the same,
+    // and only the line movement and prefetch counts kept
+    if (prefetching_) {
+        StorageStats before = stats_;
+        prefetching_ = false;
+        lower_->SetPrefetching(true);
+        HandleRequest(addr, bytes, read, content, hit, time);
+        lower_->SetPrefetching(false);
+        prefetching_ = true;
+        before.replace_num = stats_.replace_num;
+        before.fetch_num = stats_.fetch_num;
+        before.prefetch_num ++;
+        stats_ = before;
+        return;
+    }
     hit = 0;
     time = 0;
     stats_.access_counter ++;
@@ -170,6 +185,17 @@ void Cache::HandleRequest(uint64_t addr, int bytes, int read,
     }
 }
 
+int Cache::Prefetch(uint64_t addr) {
+    if (!ReplaceDecision(addr))
+        return 0;
+    char buf[BLOCK_SIZE];
+    int hit, time;
+    SetPrefetching(true);
+    HandleRequest(addr & ~(uint64_t)(BLOCK_SIZE - 1), 1, 1, buf, hit, time);
+    SetPrefetching(false);
+    return time > 0 ? time : 1;
+}
+
 int Cache::BypassDecision() {
   return FALSE;
 }
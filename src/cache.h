@@ -37,6 +37,9 @@ class Cache: public Storage {
   // Main access process
   void HandleRequest(uint64_t addr, int bytes, int read,
                      char *content, int &hit, int &time);
+  // Bring the line of addr in ahead of use, counted as a prefetch only
+  // at every level, return the fill time or 0 if the line was there
+  int Prefetch(uint64_t addr);
 
   void buildContent();
 
@@ -0,0 +1,353 @@
+#include "fpu.h"
+#include "utils.h"
+#include <cmath>
+#include <cfenv>
+#include <cfloat>
+#include <cstring>
+
+/*GCC ignores this, the Makefile builds fpu.o with -frounding-math instead*/
+#pragma STDC FENV_ACCESS ON
+
+#define CANONICAL_NAN_S 0x7fc00000u
+#define CANONICAL_NAN_D 0x7ff8000000000000ull
+
+int64_t fpBoxS(uint32_t bits){
+    return (int64_t)(0xffffffff00000000ull | bits);
+}
+
+/*a single precision value which is not NaN-boxed reads as canonical NaN*/
+static inline uint32_t bitsS(int64_t v){
+    if(((uint64_t)v >> 32) != 0xffffffff)
+        return CANONICAL_NAN_S;
+    return (uint32_t)v;
+}
+
+static inline float toS(int64_t v){
+    uint32_t bits = bitsS(v);
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+static inline int64_t fromS(float f){
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    if(std::isnan(f))
+        bits = CANONICAL_NAN_S;
+    return fpBoxS(bits);
+}
+
+static inline double toD(int64_t v){
+    double d;
+    memcpy(&d, &v, 8);
+    return d;
+}
+
+static inline int64_t fromD(double d){
+    uint64_t bits;
+    memcpy(&bits, &d, 8);
+    if(std::isnan(d))
+        bits = CANONICAL_NAN_D;
+    return (int64_t)bits;
+}
+
+static inline bool isSNaN(bool dbl, int64_t v){
+    if(dbl){
+        uint64_t bits = (uint64_t)v;
+        return ((bits >> 52) & 0x7ff) == 0x7ff && (bits & 0xfffffffffffffull) != 0 &&
+               !(bits & (1ull << 51));
+    }
+    uint32_t bits = bitsS(v);
+    return ((bits >> 23) & 0xff) == 0xff && (bits & 0x7fffff) != 0 &&
+           !(bits & (1u << 22));
+}
+
+/*
+ *RMM (round to nearest, ties to max magnitude) has no host equivalent,
+ *it is approximated with ties to even
+ */
+static int hostRound(int rm){
+    switch(rm){
+        case RM_RTZ:
+            return FE_TOWARDZERO;
+        case RM_RDN:
+            return FE_DOWNWARD;
+        case RM_RUP:
+            return FE_UPWARD;
+        default:
+            return FE_TONEAREST;
+    }
+}
+
+static void hostBegin(int rm){
+    fesetround(hostRound(rm));
+    feclearexcept(FE_ALL_EXCEPT);
+}
+
+static void hostEnd(uint32_t &fflags){
+    int e = fetestexcept(FE_ALL_EXCEPT);
+    if(e & FE_INEXACT)
+        fflags |= FFLAG_NX;
+    if(e & FE_UNDERFLOW)
+        fflags |= FFLAG_UF;
+    if(e & FE_OVERFLOW)
+        fflags |= FFLAG_OF;
+    if(e & FE_DIVBYZERO)
+        fflags |= FFLAG_DZ;
+    if(e & FE_INVALID)
+        fflags |= FFLAG_NV;
+    fesetround(FE_TONEAREST);
+}
+
+/*fmin/fmax: a single NaN operand is ignored, -0.0 is less than +0.0*/
+static int64_t fpMinMax(bool isMax, bool dbl, int64_t a, int64_t b, uint32_t &fflags){
+    if(isSNaN(dbl, a) || isSNaN(dbl, b))
+        fflags |= FFLAG_NV;
+
+    double x = dbl ? toD(a) : toS(a);
+    double y = dbl ? toD(b) : toS(b);
+    bool nx = std::isnan(x);
+    bool ny = std::isnan(y);
+    double r;
+    if(nx && ny)
+        r = NAN;
+    else if(nx)
+        r = y;
+    else if(ny)
+        r = x;
+    else if(x == y)
+        r = (std::signbit(x) != isMax) ? x : y;
+    else if(isMax)
+        r = (x > y) ? x : y;
+    else
+        r = (x < y) ? x : y;
+
+    return dbl ? fromD(r) : fromS((float)r);
+}
+
+int64_t fpArith(FpOp op, bool dbl, int64_t a, int64_t b, int64_t c,
+                int rm, uint32_t &fflags){
+    if(op == FpMin || op == FpMax)
+        return fpMinMax(op == FpMax, dbl, a, b, fflags);
+
+    int64_t res = 0;
+    hostBegin(rm);
+    if(dbl){
+        volatile double x = toD(a), y = toD(b), z = toD(c);
+        volatile double r = 0;
+        switch(op){
+            case FpAdd:   r = x + y; break;
+            case FpSub:   r = x - y; break;
+            case FpMul:   r = x * y; break;
+            case FpDiv:   r = x / y; break;
+            case FpSqrt:  r = std::sqrt(x); break;
+            case FpMadd:  r = std::fma(x, y, z); break;
+            case FpMsub:  r = std::fma(x, y, -z); break;
+            case FpNmsub: r = std::fma(-x, y, z); break;
+            case FpNmadd: r = std::fma(-x, y, -z); break;
+            default:
+                ASSERT(false);
+        }
+        res = fromD(r);
+    }
+    else{
+        volatile float x = toS(a), y = toS(b), z = toS(c);
+        volatile float r = 0;
+        switch(op){
+            case FpAdd:   r = x + y; break;
+            case FpSub:   r = x - y; break;
+            case FpMul:   r = x * y; break;
+            case FpDiv:   r = x / y; break;
+            case FpSqrt:  r = std::sqrt((float)x); break;
+            case FpMadd:  r = std::fma((float)x, (float)y, (float)z); break;
+            case FpMsub:  r = std::fma((float)x, (float)y, -z); break;
+            case FpNmsub: r = std::fma(-x, (float)y, (float)z); break;
+            case FpNmadd: r = std::fma(-x, (float)y, -z); break;
+            default:
+                ASSERT(false);
+        }
+        res = fromS(r);
+    }
+    hostEnd(fflags);
+    return res;
+}
+
+/*feq is a quiet compare, flt and fle signal on any NaN*/
+int64_t fpCompare(FpOp op, bool dbl, int64_t a, int64_t b, uint32_t &fflags){
+    double x = dbl ? toD(a) : toS(a);
+    double y = dbl ? toD(b) : toS(b);
+    bool unordered = std::isnan(x) || std::isnan(y);
+
+    if(op == FpEq){
+        if(isSNaN(dbl, a) || isSNaN(dbl, b))
+            fflags |= FFLAG_NV;
+        return (!unordered && x == y) ? 1 : 0;
+    }
+    if(unordered){
+        fflags |= FFLAG_NV;
+        return 0;
+    }
+    if(op == FpLt)
+        return (x < y) ? 1 : 0;
+    return (x <= y) ? 1 : 0;
+}
+
+int64_t fpSignInject(FpOp op, bool dbl, int64_t a, int64_t b){
+    uint64_t signBit = dbl ? (1ull << 63) : (1ull << 31);
+    uint64_t x = dbl ? (uint64_t)a : bitsS(a);
+    uint64_t y = dbl ? (uint64_t)b : bitsS(b);
+    uint64_t sign = 0;
+
+    switch(op){
+        case FpSgnj:
+            sign = y & signBit;
+            break;
+        case FpSgnjn:
+            sign = ~y & signBit;
+            break;
+        case FpSgnjx:
+            sign = (x ^ y) & signBit;
+            break;
+        default:
+            ASSERT(false);
+    }
+    uint64_t r = (x & ~signBit) | sign;
+    return dbl ? (int64_t)r : fpBoxS((uint32_t)r);
+}
+
+int64_t fpClass(bool dbl, int64_t a){
+    double x = dbl ? toD(a) : toS(a);
+    bool neg = std::signbit(x);
+
+    if(std::isnan(x))
+        return isSNaN(dbl, a) ? (1 << 8) : (1 << 9);
+
+    int cls = std::fpclassify(x);
+    /*a single subnormal widens to a double normal*/
+    if(!dbl && cls == FP_NORMAL && std::fabs(x) < FLT_MIN)
+        cls = FP_SUBNORMAL;
+
+    switch(cls){
+        case FP_INFINITE:
+            return neg ? (1 << 0) : (1 << 7);
+        case FP_NORMAL:
+            return neg ? (1 << 1) : (1 << 6);
+        case FP_SUBNORMAL:
+            return neg ? (1 << 2) : (1 << 5);
+        default:
+            return neg ? (1 << 3) : (1 << 4);
+    }
+}
+
+static double roundToInt(double x, int rm){
+    switch(rm){
+        case RM_RTZ:
+            return std::trunc(x);
+        case RM_RDN:
+            return std::floor(x);
+        case RM_RUP:
+            return std::ceil(x);
+        case RM_RMM:
+            return std::round(x);
+        default:
+            return std::nearbyint(x);
+    }
+}
+
+/*out of range and NaN inputs saturate and raise NV*/
+int64_t fpToInt(bool dbl, int64_t a, bool is64, bool isSigned,
+                int rm, uint32_t &fflags){
+    double x = dbl ? toD(a) : toS(a);
+    double lo, hi;      /*valid range is [lo, hi)*/
+    int64_t minVal, maxVal;
+
+    if(is64 && isSigned){
+        lo = -9223372036854775808.0;
+        hi = 9223372036854775808.0;
+        minVal = INT64_MIN;
+        maxVal = INT64_MAX;
+    }
+    else if(is64){
+        lo = 0;
+        hi = 18446744073709551616.0;
+        minVal = 0;
+        maxVal = -1;
+    }
+    else if(isSigned){
+        lo = -2147483648.0;
+        hi = 2147483648.0;
+        minVal = INT32_MIN;
+        maxVal = INT32_MAX;
+    }
+    else{
+        lo = 0;
+        hi = 4294967296.0;
+        minVal = 0;
+        maxVal = -1;    /*0xffffffff sign extended*/
+    }
+
+    if(std::isnan(x)){
+        fflags |= FFLAG_NV;
+        return maxVal;
+    }
+    double r = roundToInt(x, rm);
+    if(r < lo){
+        fflags |= FFLAG_NV;
+        return minVal;
+    }
+    if(r >= hi){
+        fflags |= FFLAG_NV;
+        return maxVal;
+    }
+    if(r != x)
+        fflags |= FFLAG_NX;
+
+    if(is64 && isSigned)
+        return (int64_t)r;
+    if(is64)
+        return (int64_t)(uint64_t)r;
+    if(isSigned)
+        return (int64_t)(int32_t)r;
+    return (int64_t)(int32_t)(uint32_t)r;
+}
+
+int64_t intToFp(bool dbl, int64_t a, bool is64, bool isSigned,
+                int rm, uint32_t &fflags){
+    int64_t res = 0;
+    hostBegin(rm);
+    if(dbl){
+        volatile double r;
+        if(is64)
+            r = isSigned ? (double)a : (double)(uint64_t)a;
+        else
+            r = isSigned ? (double)(int32_t)a : (double)(uint32_t)a;
+        res = fromD(r);
+    }
+    else{
+        volatile float r;
+        if(is64)
+            r = isSigned ? (float)a : (float)(uint64_t)a;
+        else
+            r = isSigned ? (float)(int32_t)a : (float)(uint32_t)a;
+        res = fromS(r);
+    }
+    hostEnd(fflags);
+    return res;
+}
+
+int64_t fpConvert(bool toDbl, int64_t a, int rm, uint32_t &fflags){
+    int64_t res = 0;
+    hostBegin(rm);
+    if(toDbl){
+        volatile float x = toS(a);
+        volatile double r = x;
+        res = fromD(r);
+    }
+    else{
+        volatile double x = toD(a);
+        volatile float r = (float)x;
+        res = fromS(r);
+    }
+    hostEnd(fflags);
+    return res;
+}
@@ -0,0 +1,52 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+/*rounding mode (rm field of an instruction or fcsr.frm)*/
+#define RM_RNE 0
+#define RM_RTZ 1
+#define RM_RDN 2
+#define RM_RUP 3
+#define RM_RMM 4
+#define RM_DYN 7
+
+/*fcsr.fflags*/
+#define FFLAG_NX 0x1
+#define FFLAG_UF 0x2
+#define FFLAG_OF 0x4
+#define FFLAG_DZ 0x8
+#define FFLAG_NV 0x10
+
+enum FpOp{
+    FpAdd, FpSub, FpMul, FpDiv, FpSqrt, FpMin, FpMax,
+    FpMadd, FpMsub, FpNmsub, FpNmadd,
+    FpSgnj, FpSgnjn, FpSgnjx,
+    FpEq, FpLt, FpLe
+};
+
+/*
+ *All operands and results are raw register bits.
+ *Single precision values live NaN-boxed in the 64-bit register.
+ *dbl selects double (true) or single (false) precision.
+ *Exceptions are accumulated into fflags.
+ */
+int64_t fpArith(FpOp op, bool dbl, int64_t a, int64_t b, int64_t c,
+                int rm, uint32_t &fflags);
+int64_t fpCompare(FpOp op, bool dbl, int64_t a, int64_t b, uint32_t &fflags);
+int64_t fpSignInject(FpOp op, bool dbl, int64_t a, int64_t b);
+int64_t fpClass(bool dbl, int64_t a);
+
+/*fcvt.{w,wu,l,lu}.{s,d}*/
+int64_t fpToInt(bool dbl, int64_t a, bool is64, bool isSigned,
+                int rm, uint32_t &fflags);
+/*fcvt.{s,d}.{w,wu,l,lu}*/
+int64_t intToFp(bool dbl, int64_t a, bool is64, bool isSigned,
+                int rm, uint32_t &fflags);
+/*fcvt.s.d (toDbl false) and fcvt.d.s (toDbl true)*/
+int64_t fpConvert(bool toDbl, int64_t a, int rm, uint32_t &fflags);
+
+/*flw and fmv.w.x: put 32 raw bits into a register*/
+int64_t fpBoxS(uint32_t bits);
+
+#endif
@@ -0,0 +1,112 @@
+#include "interval.h"
+#include "utils.h"
+#include <string.h>
+
+static const char *fieldNames[IvFieldNum] = {
+    "instrs", "cycles",
+    "l1i_access", "l1i_miss", "l1d_access", "l1d_miss",
+    "l2_access", "l2_miss", "llc_access", "llc_miss",
+    "branches", "br_mispred", "jalr", "jalr_mispred",
+    "forwarding", "load_use", "control_hazard",
+    "stall_branch_mispredict", "stall_icache", "stall_load_use",
+    "stall_dcache_l1", "stall_dcache_l2", "stall_dcache_llc",
+    "stall_ecall_serialize", "stall_structural", "stall_dependency"
+};
+
+IntervalSampler::IntervalSampler(){
+    f = NULL;
+    samples = 0;
+}
+
+bool
+IntervalSampler::Open(const char *path, uint64_t period, bool byCycles, bool binary){
+    ASSERT(period > 0);
+    f = fopen(path, binary ? "wb" : "w");
+    if(f == NULL){
+        printf("Fail to create interval file %s!\n", path);
+        return false;
+    }
+    this->period = period;
+    this->byCycles = byCycles;
+    this->binary = binary;
+    next = period;
+    memset(&last, 0, sizeof(last));
+
+    if(binary){
+        IntervalHeader h;
+        h.magic = INTERVAL_MAGIC;
+        h.version = INTERVAL_VERSION;
+        h.fieldNum = IvFieldNum;
+        h.byCycles = byCycles;
+        h.period = period;
+        fwrite(&h, sizeof(h), 1, f);
+    }
+    else{
+        fprintf(f, "end_instr,end_cycle");
+        for(int i = 0; i < IvFieldNum; i++)
+            fprintf(f, ",%s", fieldNames[i]);
+        fprintf(f, ",cpi,l1i_miss_rate,l1d_miss_rate,l2_miss_rate,llc_miss_rate,mpki,cpi_base");
+        for(int i = IvStallBranch; i < IvFieldNum; i++)
+            fprintf(f, ",cpi_%s", fieldNames[i] + 6);
+        fputc('\n', f);
+    }
+    return true;
+}
+
+static double
+ratio(uint64_t a, uint64_t b){
+    return b > 0 ? (double)a / b : 0.0;
+}
+
+void
+IntervalSampler::write(const IntervalCounters &d){
+    if(binary){
+        fwrite(d.v, sizeof(d.v), 1, f);
+        return;
+    }
+    fprintf(f, "%llu,%llu", (unsigned long long)last.v[IvInstrs], (unsigned long long)last.v[IvCycles]);
+    for(int i = 0; i < IvFieldNum; i++)
+        fprintf(f, ",%llu", (unsigned long long)d.v[i]);
+    fprintf(f, ",%.4f,%.6f,%.6f,%.6f,%.6f,%.4f",
+            ratio(d.v[IvCycles], d.v[IvInstrs]),
+            ratio(d.v[IvL1IMiss], d.v[IvL1IAccess]),
+            ratio(d.v[IvL1DMiss], d.v[IvL1DAccess]),
+            ratio(d.v[IvL2Miss], d.v[IvL2Access]),
+            ratio(d.v[IvLLCMiss], d.v[IvLLCAccess]),
+            1000.0 * ratio(d.v[IvBrMispred] + d.v[IvJalrMispred], d.v[IvInstrs]));
+
+    /*CPI stack of the interval, base may dip below 0 when results land late*/
+    double base = (double)d.v[IvCycles];
+    for(int i = IvStallBranch; i < IvFieldNum; i++)
+        base -= (double)d.v[i];
+    fprintf(f, ",%.4f", d.v[IvInstrs] > 0 ? base / d.v[IvInstrs] : 0.0);
+    for(int i = IvStallBranch; i < IvFieldNum; i++)
+        fprintf(f, ",%.4f", ratio(d.v[i], d.v[IvInstrs]));
+    fputc('\n', f);
+}
+
+void
+IntervalSampler::Sample(const IntervalCounters &now){
+    IntervalCounters d;
+    for(int i = 0; i < IvFieldNum; i++)
+        d.v[i] = now.v[i] - last.v[i];
+    last = now;
+    write(d);
+    samples ++;
+
+    /*a long stall may cover several periods, they make one sample*/
+    uint64_t pos = byCycles ? now.v[IvCycles] : now.v[IvInstrs];
+    while(next <= pos)
+        next += period;
+}
+
+/*the rest of the run as a last, short interval*/
+void
+IntervalSampler::Close(const IntervalCounters &now){
+    if(f == NULL)
+        return;
+    if(now.v[IvInstrs] > last.v[IvInstrs])
+        Sample(now);
+    fclose(f);
+    f = NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define INTERVAL_MAGIC 0x56495652   //"RVIV"
+#define INTERVAL_VERSION 2
+
+/*
+    Running totals the sampler takes deltas of, in this order. The stall
+    cycles follow the scoreboard's CpiField order, base is the cycles
+    they leave.
+*/
+enum IntervalField{
+    IvInstrs, IvCycles,
+    IvL1IAccess, IvL1IMiss, IvL1DAccess, IvL1DMiss,
+    IvL2Access, IvL2Miss, IvLLCAccess, IvLLCMiss,
+    IvBranches, IvBrMispred, IvJalr, IvJalrMispred,
+    IvForwarding, IvLoadUse, IvControl,
+    IvStallBranch, IvStallICache, IvStallLoadUse, IvStallDL1, IvStallDL2, IvStallDLLC,
+    IvStallSerial, IvStallStruct, IvStallDepend,
+    IvFieldNum
+};
+
+typedef struct IntervalCounters{
+    uint64_t v[IvFieldNum];
+}IntervalCounters;
+
+/*
+    Binary series: this header, then per interval fieldNum uint64_t
+    deltas in IntervalField order, the last interval may be short.
+*/
+typedef struct IntervalHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fieldNum;
+    uint32_t byCycles;
+    uint64_t period;
+}IntervalHeader;
+
+/*
+ *Writes a sample every period instructions (or cycles) to a CSV or
+ *binary file. Due() is one compare per instruction, everything else
+ *only runs at the end of an interval.
+ */
+class IntervalSampler{
+public:
+    IntervalSampler();
+    bool Open(const char *path, uint64_t period, bool byCycles, bool binary);
+    void Sample(const IntervalCounters &now);
+    void Close(const IntervalCounters &now);
+
+    bool Due(uint64_t instrs, uint64_t cycles){
+        return (byCycles ? cycles : instrs) >= next;
+    }
+
+    long long samples;
+
+private:
+    void write(const IntervalCounters &d);
+
+    FILE *f;
+    bool binary;
+    bool byCycles;
+    uint64_t period;
+    uint64_t next;
+    IntervalCounters last;
+};
+
+#endif
@@ -5,9 +5,16 @@
 
 using namespace std;
 
-Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
-    for(int i = 0; i < REG_NUM; i++)
+Machine::Machine() : PhyMem(MEM_SIZE), L1I(), L1D(), L2(), LLC(){
+    for(int i = 0; i < REG_NUM + FREG_NUM; i++)
         registers[i] = 0;
+    fcsr = 0;
+    reservation = 0;
+    reservationValid = false;
+    vlen = 128;
+    vecVl = 0;
+    vecVtype = 1ull << 63;  /*vill until the first vsetvl*/
+    memset(vregs, 0, sizeof(vregs));
 
     stackTop = 0;
     machineCycle = 0;
@@ -17,6 +24,12 @@ Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
     /*initialize bmp & page table*/
     bmp = new BitMap(pageNum);
     MyPred = Predictor(); 
+    brTrace = NULL;
+    intervals = NULL;
+    profiler = NULL;
+    reuse = NULL;
+    sweep = NULL;
+    sweepThreads = 1;
     ptb.clear();
 
     machineStats.cycle = 0;
@@ -28,6 +41,40 @@ Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
     machineStats.misPrediction = 0;
     machineStats.ecallNum = 0;
     machineStats.FSTALL = 0;
+    machineStats.fetchAccess = 0;
+    machineStats.fetchBytes = 0;
+    machineStats.compressedCnt = 0;
+    machineStats.straddleFetch = 0;
+    machineStats.atomicCnt = 0;
+    machineStats.scFail = 0;
+    machineStats.vecInstr = 0;
+    machineStats.vecMemAccess = 0;
+    machineStats.jalrCnt = 0;
+    machineStats.jalrPredicted = 0;
+    machineStats.fetchBlocks = 0;
+    machineStats.ftqEmpty = 0;
+    machineStats.ftqFull = 0;
+    machineStats.fdipPrefetch = 0;
+    machineStats.groupDep = 0;
+    machineStats.groupFu = 0;
+    for(int i = 0; i <= MAX_ISSUE; i++)
+        machineStats.issueHist[i] = 0;
+
+    issueWidth = 1;
+    issueAlu = 1;
+    issueMul = 1;
+    issueMem = 1;
+    oooModel = false;
+    timing = &sboard;
+    statsCsv = false;
+    memTime = 0;
+    memMiss = 0;
+    memLevel = 0;
+    fetchMiss = 0;
+
+    ftqEntries = FTQ_ENTRIES;
+    fetchBlock = FETCH_BLOCK;
+    fdip = false;
 
     for(int i = 0; i < INSTRNUM; i++)
         instrPfm[i] = 1;
@@ -44,7 +91,8 @@ Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
     s.fetch_num = 0;
     s.prefetch_num = 0; 
     PhyMem.SetStats(s);
-    L1.SetStats(s);
+    L1I.SetStats(s);
+    L1D.SetStats(s);
     L2.SetStats(s);
     LLC.SetStats(s);
 
@@ -56,8 +104,9 @@ Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
     PhyMem.SetLatency(Memory_latency);
 
     //L1 latency
-    L1_latency.bus_latency = 0;
-    L1_latency.hit_latency = 1; /*CPU cycle*/
+    L1D_latency.bus_latency = 0;
+    L1D_latency.hit_latency = 1; /*CPU cycle*/
+    L1I_latency = L1D_latency;
 
     //L2 latency
     L2_latency.bus_latency = 0;
@@ -68,22 +117,28 @@ Machine::Machine() : PhyMem(MEM_SIZE), L1(), L2(), LLC(){
     LLC_latency.hit_latency = 20; /*CPU cycle*/
 
     //L1 cache config
-    L1_config.size = 32 * 1024;
-    L1_config.associativity = 8;
-    L1_config.set_num = L1_config.size / (L1_config.associativity * BLOCK_SIZE);
-    if(L1_config.size % (L1_config.associativity * BLOCK_SIZE) != 0){
+    L1D_config.size = 32 * 1024;
+    L1D_config.associativity = 8;
+    L1D_config.set_num = L1D_config.size / (L1D_config.associativity * BLOCK_SIZE);
+    if(L1D_config.size % (L1D_config.associativity * BLOCK_SIZE) != 0){
         printf("Please give proper cache config!\n");
         ASSERT(false);
     }
-    L1_config.write_through = 0;
-    L1_config.write_allocate = 0;
+    L1D_config.write_through = 0;
+    L1D_config.write_allocate = 0;
 
-    L2_config = L1_config;
-    LLC_config = L1_config;
+    L1I_config = L1D_config;
+    L2_config = L1D_config;
+    LLC_config = L1D_config;
 }
 
 Machine::~Machine(){
     delete bmp;
+    delete brTrace;
+    delete intervals;
+    delete profiler;
+    delete reuse;
+    delete sweep;
 }
 
 void
@@ -98,21 +153,26 @@ Machine::SetCacheConfig(){
     s.fetch_num = 0;
     s.prefetch_num = 0; 
     PhyMem.SetStats(s);
-    L1.SetStats(s);
+    L1I.SetStats(s);
+    L1D.SetStats(s);
     L2.SetStats(s);
     LLC.SetStats(s);
 
 
     PhyMem.SetLatency(Memory_latency);
-    L1.SetLatency(L1_latency);
+    L1I.SetLatency(L1I_latency);
+    L1D.SetLatency(L1D_latency);
     L2.SetLatency(L2_latency);
     LLC.SetLatency(LLC_latency);
 
-    L1.SetConfig(L1_config);
+    L1I.SetConfig(L1I_config);
+    L1D.SetConfig(L1D_config);
     L2.SetConfig(L2_config);
     LLC.SetConfig(LLC_config);
 
-    L1.SetLower(&L2);
+    /*split L1, unified below*/
+    L1I.SetLower(&L2);
+    L1D.SetLower(&L2);
     L2.SetLower(&LLC);
     LLC.SetLower(&PhyMem);
 }
@@ -122,34 +182,264 @@ Machine::SetPredScheme(Scheme s){
     MyPred.SetScheme(s);
 }
 
+bool
+Machine::SetBranchTrace(const char *path){
+    brTrace = new BranchTraceWriter();
+    if(!brTrace->Open(path)){
+        printf("Fail to create branch trace %s!\n", path);
+        delete brTrace;
+        brTrace = NULL;
+        return false;
+    }
+    return true;
+}
+
+void
+Machine::SetCoreModel(bool outOfOrder){
+    oooModel = outOfOrder;
+    if(outOfOrder)
+        timing = &ooo;
+    else
+        timing = &sboard;
+    stats.Config("core", outOfOrder ? "ooo" : "inorder");
+}
+
+/*a path ending in .bin gets the binary series, anything else CSV*/
+bool
+Machine::SetIntervals(const char *path, uint64_t period, bool byCycles){
+    size_t len = strlen(path);
+    bool binary = len > 4 && strcmp(path + len - 4, ".bin") == 0;
+    intervals = new IntervalSampler();
+    if(!intervals->Open(path, period, byCycles, binary)){
+        delete intervals;
+        intervals = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*symbols of the program being run name the PCs in the profile*/
+bool
+Machine::SetProfile(const char *path, const char *elfPath){
+    profiler = new Profiler();
+    profilePath = path;
+    programPath = elfPath;
+    if(!profiler->LoadSymbols(elfPath))
+        printf("No symbols in %s, the profile shows bare PCs\n", elfPath);
+    return true;
+}
+
+void
+Machine::SetReuse(const char *path, double rate, uint64_t window){
+    reuse = new ReuseAnalyzer(CACHE_B, rate, window);
+    reusePath = path;
+}
+
+/*the configs come from Sweep_Config lines, set up in Run*/
+void
+Machine::SetSweep(const char *path, int threads){
+    sweep = new CacheSweep();
+    sweepPath = path;
+    sweepThreads = threads;
+}
+
+IntervalCounters
+Machine::intervalCounters(){
+    IntervalCounters c;
+    StorageStats s;
+    c.v[IvInstrs] = timing->instrs;
+    c.v[IvCycles] = timing->Cycles();
+    L1I.GetStats(s);
+    c.v[IvL1IAccess] = s.access_counter;
+    c.v[IvL1IMiss] = s.miss_num;
+    L1D.GetStats(s);
+    c.v[IvL1DAccess] = s.access_counter;
+    c.v[IvL1DMiss] = s.miss_num;
+    L2.GetStats(s);
+    c.v[IvL2Access] = s.access_counter;
+    c.v[IvL2Miss] = s.miss_num;
+    LLC.GetStats(s);
+    c.v[IvLLCAccess] = s.access_counter;
+    c.v[IvLLCMiss] = s.miss_num;
+    c.v[IvBranches] = machineStats.misPrediction + machineStats.sucPrediction;
+    c.v[IvBrMispred] = machineStats.misPrediction;
+    c.v[IvJalr] = machineStats.jalrCnt;
+    c.v[IvJalrMispred] = machineStats.jalrCnt - machineStats.jalrPredicted;
+    c.v[IvForwarding] = machineStats.dataHazard;
+    c.v[IvLoadUse] = machineStats.loadUseHazard;
+    c.v[IvControl] = machineStats.controlHazard;
+    for(int i = 0; i < CpiFieldNum; i++)
+        c.v[IvStallBranch + i] = sboard.cpiStall[i];
+    return c;
+}
+
+void
+Machine::SetStatsFile(const char *path, bool csv){
+    statsFile = path;
+    statsCsv = csv;
+}
 
+/*hand every counter Halt prints to the registry, under its part of the machine*/
 void
+Machine::RegisterStats(){
+    stats.Clear();
+    stats.Counter("core.instrs", &machineStats.instrCnt);
+    stats.Counter("core.pipeline_cycles", &machineCycle, "pipeline steps of the functional model");
+    stats.Counter("core.slowest_stage_ticks", &machineStats.cycle);
+    stats.Formula("core.cpi", [this](){
+        return machineStats.instrCnt > 0 ? (double)timing->Cycles() / machineStats.instrCnt : 0.0;
+    });
+    stats.Counter("core.hazard.forwarding", &machineStats.dataHazard);
+    stats.Counter("core.hazard.load_use", &machineStats.loadUseHazard);
+    stats.Counter("core.hazard.control", &machineStats.controlHazard);
+    stats.Counter("core.ecalls", &machineStats.ecallNum);
+    stats.Counter("core.fetch_stalls", &machineStats.FSTALL);
+    stats.Counter("core.atomics", &machineStats.atomicCnt);
+    stats.Counter("core.sc_failed", &machineStats.scFail);
+    stats.Counter("core.vector.instrs", &machineStats.vecInstr);
+    stats.Counter("core.vector.line_accesses", &machineStats.vecMemAccess);
+    stats.Histogram("core.issue.per_cycle", machineStats.issueHist, issueWidth + 1, "cycles by instrs issued");
+    stats.Counter("core.issue.cut_dependency", &machineStats.groupDep);
+    stats.Counter("core.issue.cut_unit", &machineStats.groupFu);
+    if(oooModel)
+        ooo.RegisterStats(stats, "core.ooo");
+    else
+        sboard.RegisterStats(stats, "core.timing");
+
+    stats.Counter("frontend.fetch_accesses", &machineStats.fetchAccess);
+    stats.Counter("frontend.straddling", &machineStats.straddleFetch);
+    stats.Counter("frontend.fetch_bytes", &machineStats.fetchBytes);
+    stats.Counter("frontend.compressed", &machineStats.compressedCnt);
+    stats.Counter("frontend.fetch_blocks", &machineStats.fetchBlocks);
+    stats.Counter("frontend.ftq_empty", &machineStats.ftqEmpty);
+    stats.Counter("frontend.ftq_full", &machineStats.ftqFull);
+    stats.Counter("frontend.fdip_prefetches", &machineStats.fdipPrefetch);
+
+    stats.Counter("pred.mispredictions", &machineStats.misPrediction);
+    stats.Counter("pred.correct", &machineStats.sucPrediction);
+    stats.Formula("pred.accuracy", [this](){
+        long long n = machineStats.misPrediction + machineStats.sucPrediction;
+        return n > 0 ? (double)machineStats.sucPrediction / n : 0.0;
+    });
+    stats.Counter("pred.jalr", &machineStats.jalrCnt);
+    stats.Counter("pred.jalr_predicted", &machineStats.jalrPredicted);
+    MyPred.RegisterStats(stats, "pred");
+
+    L1I.RegisterStats(stats, "cache.l1i");
+    L1D.RegisterStats(stats, "cache.l1d");
+    L2.RegisterStats(stats, "cache.l2");
+    LLC.RegisterStats(stats, "cache.llc");
+    PhyMem.RegisterStats(stats, "memory");
+
+    /*no TLB, translation walks the page table map*/
+    stats.Formula("mmu.pages_mapped", [this](){ return (double)ptb.size(); });
+}
+
+
+int
 Machine::readBytes(uint64_t addr, int nbytes, void *val){
     ASSERT(addr + nbytes < MEM_SIZE + 1);
     int hit, time;
-    L1.HandleRequest(addr, nbytes, 1, (char *)val, hit, time);
+    long long l2Misses = L2.GetMisses();
+    long long llcMisses = LLC.GetMisses();
+    L1D.HandleRequest(addr, nbytes, 1, (char *)val, hit, time);
+    if(reuse != NULL)
+        reuse->Access(addr);
+    if(sweep != NULL)
+        sweep->Access(addr, nbytes, 1);
 
     if(time > TicksPerCycle)
         TicksPerCycle = time;
+    memTime += time;
+    memMiss += !hit;
+    if(!hit)
+        noteMiss(l2Misses, llcMisses);
 
     if(debug)
         printf("Usrprog readBytes at:%lx Use cpu cycles:%d\n", addr, time);
+    return time;
 }
 
-void 
+/*how far down an L1D miss went, from the miss counts before it*/
+void
+Machine::noteMiss(long long l2Misses, long long llcMisses){
+    int level = 1;
+    if(LLC.GetMisses() > llcMisses)
+        level = 3;
+    else if(L2.GetMisses() > l2Misses)
+        level = 2;
+    if(level > memLevel)
+        memLevel = level;
+}
+
+int
+Machine::readInstr(uint64_t addr, int nbytes, void *val){
+    ASSERT(addr + nbytes < MEM_SIZE + 1);
+    int hit, time;
+    L1I.HandleRequest(addr, nbytes, 1, (char *)val, hit, time);
+
+    if(time > TicksPerCycle)
+        TicksPerCycle = time;
+    fetchMiss += !hit;
+
+    if(debug)
+        printf("Usrprog readInstr at:%lx Use cpu cycles:%d\n", addr, time);
+    return time;
+}
+
+int 
 Machine::writeBytes(uint64_t addr, int nbytes, void *val){
     ASSERT(addr + nbytes < MEM_SIZE + 1);
     int hit, time;
-    L1.HandleRequest(addr, nbytes, 0, (char *)val, hit, time);
+
+    /*a store to the reserved line makes the pending sc fail*/
+    if(reservationValid && reservation == (addr & ~(uint64_t)(BLOCK_SIZE - 1)))
+        reservationValid = false;
+
+    long long l2Misses = L2.GetMisses();
+    long long llcMisses = LLC.GetMisses();
+    L1D.HandleRequest(addr, nbytes, 0, (char *)val, hit, time);
+    if(reuse != NULL)
+        reuse->Access(addr);
+    if(sweep != NULL)
+        sweep->Access(addr, nbytes, 0);
     
     if(time > TicksPerCycle)
         TicksPerCycle = time;
+    memTime += time;
+    memMiss += !hit;
+    if(!hit)
+        noteMiss(l2Misses, llcMisses);
 
     if(debug)
         printf("Usrprog writeBytes at:%lx Use cpu cycles:%d\n", addr, time);
+    return time;
 }
 
 
+int
+Machine::vectorAccess(uint64_t virAddr, int nbytes, void *val, bool read){
+    char *buf = (char *)val;
+    int total = 0;
+
+    while(nbytes > 0){
+        int chunk = BLOCK_SIZE - (virAddr & (BLOCK_SIZE - 1));
+        if(chunk > nbytes)
+            chunk = nbytes;
+        uint64_t phyAddr = translateAddr(virAddr);
+        if(read)
+            total += readBytes(phyAddr, chunk, buf);
+        else
+            total += writeBytes(phyAddr, chunk, buf);
+        machineStats.vecMemAccess ++;
+
+        virAddr += chunk;
+        buf += chunk;
+        nbytes -= chunk;
+    }
+    return total;
+}
+
 void
 Machine::AllocPageEntry(uint64_t vpn){
     pageEntry pe;
@@ -179,7 +469,7 @@ Machine::translateAddr(uint64_t virAddr){
 
     std::map<uint64_t, pageEntry>::iterator itr = ptb.find(vpn);
     if(itr == ptb.end()){
-        printf("PageFault Exception at %llx at cycle:%d\n", virAddr, machineCycle);
+        printf("PageFault Exception at %llx at cycle:%lld\n", virAddr, machineCycle);
         fflush(stdout);
         printf("%s\n", "virtual Address has no corresponding page entry!");
         ASSERT(false);
@@ -272,18 +562,71 @@ Machine::Run(){
 
     StackAllocate();
     SetCacheConfig();
+    if(sweep != NULL && sweepConfigs.empty()){
+        printf("No Sweep_Config lines, cache sweep off\n");
+        delete sweep;
+        sweep = NULL;
+    }
+    if(sweep != NULL){
+        for(size_t i = 0; i < sweepConfigs.size(); i++)
+            sweep->AddConfig(sweepConfigs[i].first, sweepConfigs[i].second);
+        sweep->Start(sweepThreads);
+    }
+    /*
+        Both timing models share one FU table. Without FU lines the
+        alu / mul / mem counts follow Issue_Config, or OOO_Config for
+        the out-of-order core, and dividers block.
+    */
+    const char *unitCfg = oooModel ? "OOO_Config" : "Issue_Config";
+    int counts[3] = {issueAlu, issueMul, issueMem};
+    if(oooModel){
+        counts[0] = ooo.units[FuAlu];
+        counts[1] = ooo.units[FuMul];
+        counts[2] = ooo.units[FuMem];
+    }
+    if(sboard.fus.empty()){
+        sboard.AddUnit("alu", counts[0], 0, 1, 1u << OpInt);
+        sboard.AddUnit("mul", counts[1], 0, 1, (1u << OpMul) | (1u << OpFp) | (1u << OpVec));
+        sboard.AddUnit("div", 1, 0, 0, (1u << OpDiv) | (1u << OpFdiv));
+        sboard.AddUnit("mem", counts[2], 0, 0, (1u << OpLoad) | (1u << OpStore));
+    }
+    else{
+        const char *names[3] = {"alu", "mul", "mem"};
+        for(size_t i = 0; i < sboard.fus.size(); i++)
+            for(int k = 0; k < 3; k++)
+                if(sboard.fus[i].name == names[k] && sboard.fus[i].count != counts[k])
+                    printf("Warning: FU %s count:%d overrides %s's %d\n",
+                           names[k], sboard.fus[i].count, unitCfg, counts[k]);
+    }
+    sboard.loadHit = L1D_latency.bus_latency + L1D_latency.hit_latency;
+    sboard.Init(issueWidth, ftqEntries);
+    ooo.SetUnits(sboard.fus);
+    RegisterStats();
+
+    /*empty fetch target queue, slots for a block of compressed instrs*/
+    FtqEntry empty;
+    empty.slots.resize(fetchBlock / 2);
+    ftq.assign(ftqEntries, empty);
+    ftqHead = 0;
+    ftqCount = 0;
+    ftqSlot = 0;
+    fetchNum = 0;
+    decodeNum = 0;
+    predStop = false;
 
     /*set bubble and stall*/
     FReg.bubble = false;
     FReg.stall = false;
-    DReg.bubble = true;
-    DReg.stall = false;
-    EReg.bubble = true;
-    EReg.stall = false;
-    MReg.bubble = true;
-    MReg.stall = false;
-    WReg.bubble = true;
-    WReg.stall = false;
+    for(int l = 0; l < MAX_ISSUE; l++){
+        DReg[l].bubble = true;
+        DReg[l].stall = false;
+        EReg[l].bubble = true;
+        EReg[l].stall = false;
+        MReg[l].bubble = true;
+        MReg[l].stall = false;
+        WReg[l].bubble = true;
+        WReg[l].stall = false;
+    }
 
     printf("start pipeline...\n\n");
     if(sgStep){
@@ -301,7 +644,13 @@ Machine::Run(){
         TicksPerCycle = 1;
         /*print INFO*/
         if(sgStep || debug)
-            printf("\n<<<<cycle:%d>>>>>\n", machineCycle);
+            printf("\n<<<<cycle:%lld>>>>>\n", machineCycle);
+
+        /*
+            Every stage takes up to issueWidth instructions, one per
+            lane, and each pipeline register is latched once.
+        */
+        PredictBlock();
 
         /*five stage*/
         Fetch();
@@ -309,13 +658,15 @@ Machine::Run(){
         Execute();
         MemStage();
         Writeback();
-      
 
         if(debug){
             printReg();
             printPipe();
         }
 
+        latch();
+        registers[ZEROREG] = 0;  //keep zero reg 0
+
         if(sgStep || debug){
             printf("<<<<end cycle>>>>\n\n");
         }
@@ -324,65 +675,284 @@ Machine::Run(){
         if(sgStep)
             printSingleStep();
 
-         /*
-            Special predPC condition caused by load-use hazard.
-            Need to set PC back;
-        */
-        if(FReg.stall){
-            FReg.stall = false;
-            this->predPC = this->PC;
-            machineStats.FSTALL ++;
-        }
-        
+        machineCycle ++;        //cycle + 1
+        machineStats.cycle += TicksPerCycle;
+    }
+}
 
-        if(DReg.stall)
-            DReg.stall = false;
-        else 
-            DReg = DRegO;
+/*unit class of an instruction for the per-cycle issue limits*/
+static int
+fuClass(const Instruction &instr){
+    switch(instr.opcode){
+        case 0x03: case 0x07: case 0x23: case 0x27: case 0x2f:
+            return FuMem;
+        case 0x33: case 0x3b:
+            return ((instr.ival >> 25) == 0x1) ? FuMul : FuAlu;
+        case 0x43: case 0x47: case 0x4b: case 0x4f: case 0x53: case 0x57:
+            return FuMul;
+        default:
+            return FuAlu;
+    }
+}
 
-        if(EReg.stall)
-            EReg.stall = false;
-        else 
-            EReg = ERegO;
+/*what the instruction asks of a functional unit*/
+static int
+opClass(const Instruction &instr){
+    int funct3 = (instr.ival >> 12) & 0x7;
+    switch(instr.opcode){
+        case 0x03: case 0x07: case 0x2f:
+            return OpLoad;
+        case 0x23: case 0x27:
+            return OpStore;
+        case 0x33: case 0x3b:
+            if((instr.ival >> 25) != 0x1)
+                return OpInt;
+            return funct3 < 4 ? OpMul : OpDiv;
+        case 0x43: case 0x47: case 0x4b: case 0x4f:
+            return OpFp;
+        case 0x53:
+            /*fdiv and fsqrt*/
+            return ((instr.ival >> 27) == 0x03 || (instr.ival >> 27) == 0x0b) ? OpFdiv : OpFp;
+        case 0x57:
+            return OpVec;
+        default:
+            return OpInt;
+    }
+}
 
-        if(MReg.stall)
-            MReg.stall = false;
-        else
-            MReg = MRegO;
+/*
+    May the instruction Decode put in ERegO[lane] issue with the older
+    lanes of its group? It must not read a register they write, nor one
+    a load in Execute only has after MemStage (load-use), and its unit
+    class must have a unit left.
+*/
+bool
+Machine::canIssue(int lane){
+    const PipReg &r = ERegO[lane];
+    for(int i = 0; i < issueWidth; i++){
+        int64_t d = EReg[i].bubble ? 0 : EReg[i].dstM;
+        if(d != 0 && (d == r.srcA || d == r.srcB || d == r.srcC)){
+            if(debug){
+                printf("\nload-use hazard\n");
+                printf("instr:%x dstM:%lld\n", EReg[i].instr.ival, d);
+            }
+            machineStats.loadUseHazard ++;
+            if(profiler != NULL)
+                profiler->LoadUse(r.instr.addr);
+            return false;
+        }
+    }
 
-        if(WReg.stall)
-            WReg.stall = false;
-        else 
-            WReg = WRegO;
+    int used[3] = {0, 0, 0};
+    for(int i = 0; i < lane; i++){
+        const PipReg &o = ERegO[i];
+        int64_t d[2] = {o.dstE, o.dstM};
+        for(int k = 0; k < 2; k++)
+            if(d[k] != 0 && (d[k] == r.srcA || d[k] == r.srcB || d[k] == r.srcC)){
+                machineStats.groupDep ++;
+                return false;
+            }
+        used[fuClass(o.instr)] ++;
+    }
+    int limit[3] = {issueAlu, issueMul, issueMem};
+    int c = fuClass(r.instr);
+    if(used[c] == limit[c]){
+        machineStats.groupFu ++;
+        return false;
+    }
+    return true;
+}
 
-        /*data forwading signal reset*/
-        forwardA = false;
-        forwardB = false;
+/*
+    Pass a result on to the lanes Decode read operands for this cycle,
+    unless a younger instruction already did. Stages call it for their
+    youngest lane first.
+*/
+void
+Machine::forward(int64_t dst, int64_t val, const char *stage){
+    if(dst == 0)
+        return;
+    for(int l = 0; l < issueWidth; l++){
+        PipReg &r = ERegO[l];
+        if(r.bubble)
+            continue;
+        if(r.srcA == dst && !forwardA[l]){
+            r.valA = val;
+            forwardA[l] = true;
+            if(debug)
+                printf("%s forwardA:%lld val:%llx\n", stage, dst, val);
+            machineStats.dataHazard ++;
+        }
+        if(r.srcB == dst && !forwardB[l]){
+            r.valB = val;
+            forwardB[l] = true;
+            if(debug)
+                printf("%s forwardB:%lld val:%llx\n", stage, dst, val);
+            machineStats.dataHazard ++;
+        }
+        if(r.srcC == dst && !forwardC[l]){
+            r.valD = val;
+            forwardC[l] = true;
+            if(debug)
+                printf("%s forwardC:%lld val:%llx\n", stage, dst, val);
+            machineStats.dataHazard ++;
+        }
+    }
+}
 
-        registers[ZEROREG] = 0;  //keep zero reg 0
-        machineCycle ++;        //cycle + 1
-        machineStats.cycle += TicksPerCycle;
+/*Execute redirected, what Fetch and Decode hold is on the wrong path*/
+void
+Machine::flushYounger(){
+    for(int l = 0; l < issueWidth; l++){
+        DRegO[l].bubble = true;
+        DReg[l].bubble = true;
+        ERegO[l].bubble = true;
     }
 }
 
-const char *instrName_cstr[60] ={
+/*
+    End of a cycle. The lanes Decode could not issue move to the front
+    of DReg and fetched instrs fill in behind them, those that do not
+    fit are fetched again. The other registers take their stage's
+    output as is.
+*/
+void
+Machine::latch(){
+    int n = 0;
+    for(int l = decodeNum; l < issueWidth; l++)
+        if(!DReg[l].bubble)
+            DReg[n ++] = DReg[l];
+    int taken = 0;
+    for(; taken < fetchNum && n < issueWidth; taken++)
+        DReg[n ++] = DRegO[taken];
+    for(; n < issueWidth; n++)
+        DReg[n].bubble = true;
+
+    /*load-use hazard or ecall, the instr stays at the FTQ head*/
+    FReg.stall = taken < fetchNum;
+    if(FReg.stall)
+        machineStats.FSTALL ++;
+    ftqAdvance(taken);
+
+    for(int l = 0; l < issueWidth; l++){
+        EReg[l] = ERegO[l];
+        MReg[l] = MRegO[l];
+        WReg[l] = WRegO[l];
+    }
+}
+
+/*
+    Hand the instruction leaving Writeback to the timing models, with
+    the latencies the pipeline measured for it.
+*/
+void
+Machine::retireTiming(const PipReg &r){
+    const Instruction &instr = r.instr;
+    OooInstr in;
+    int funct3 = (instr.ival >> 12) & 0x7;
+
+    in.pc = instr.addr;
+    in.fu = fuClass(instr);
+    in.op = opClass(instr);
+    in.lat = instrPfm[instr.name];
+    in.src[0] = r.srcA;
+    in.src[1] = r.srcB;
+    in.src[2] = r.srcC;
+    in.dst[0] = r.dstE;
+    in.dst[1] = r.dstM;
+    for(int i = 0; i < 3; i++)
+        if(in.src[i] < 0 || in.src[i] >= OOO_ARCH_REGS)
+            in.src[i] = 0;
+    for(int i = 0; i < 2; i++)
+        if(in.dst[i] < 0 || in.dst[i] >= OOO_ARCH_REGS)
+            in.dst[i] = 0;
+    if(in.dst[0] == in.dst[1])
+        in.dst[1] = 0;
+
+    in.load = instr.opcode == 0x03 || instr.opcode == 0x07;
+    in.store = instr.opcode == 0x23 || instr.opcode == 0x27;
+    in.size = 0;
+    if(instr.opcode == 0x03 || instr.opcode == 0x23)
+        in.size = 1 << (funct3 & 0x3);
+    else if((instr.opcode == 0x07 || instr.opcode == 0x27) && (funct3 == 2 || funct3 == 3))
+        in.size = funct3 == 2 ? 4 : 8;     /*flw / fld, vector accesses are never forwarded*/
+    else if(instr.opcode == 0x2f){
+        int funct5 = instr.ival >> 27;
+        in.load = funct5 != 0x03;           /*all but sc read*/
+        in.store = funct5 != 0x02;          /*all but lr write*/
+        in.size = funct3 == 2 ? 4 : 8;
+    }
+    in.addr = r.valE;
+    in.memLat = r.memLat;
+    in.memLevel = r.memLevel;
+    in.fetchLat = r.fetchLat;
+    /*branches leave the condition in valE, jal and jalr always jump*/
+    in.taken = (instr.opcode == 0x63) ? r.valE != 0 : (instr.opcode == 0x6f || instr.opcode == 0x67);
+    in.mispredict = r.mispredict;
+    in.serialize = instr.opcode == 0x73;
+    timing->Retire(in);
+    if(profiler != NULL){
+        profiler->Retire(in.pc, timing->LastIssue(), r.fetchMiss, r.memMiss, in.mispredict);
+        if(instr.opcode == 0x6f || instr.opcode == 0x67)
+            profileCall(r);
+    }
+    if(intervals != NULL && intervals->Due(timing->instrs, timing->Cycles()))
+        intervals->Sample(intervalCounters());
+}
+
+/*
+    The link register hints of the ISA: a jal or jalr writing ra or t0
+    is a call, a jalr through one of them writing x0 a return, and a
+    jalr doing both returns and calls at once.
+*/
+void
+Machine::profileCall(const PipReg &r){
+    const Instruction &instr = r.instr;
+    int rd = (instr.ival >> 7) & 0x1f;
+    int rs1 = (instr.ival >> 15) & 0x1f;
+    bool link = rd == 1 || rd == 5;
+    uint64_t target = instr.opcode == 0x6f ? instr.addr + r.imm : r.valC;
+
+    if(instr.opcode == 0x67 && (rs1 == 1 || rs1 == 5) && rs1 != rd)
+        profiler->Return(target);
+    if(link)
+        profiler->Call(instr.addr, target, instr.addr + instr.len);
+}
+
+const char *instrName_cstr[INSTRNUM] ={
     "add", "mul", "sub", "sll", "mulh", "slt", "xor", "div", "srl", "sra",
     "or", "rem", "and", "lb", "lh", "lw", "ld", "addi", "slli", "slti",
     "xori", "srli", "srai", "ori", "andi", "addiw", "jalr", "ecall", "sb", "sh",
     "sw", "sd", "beq", "bne", "blt", "bge", "auipc", "lui", "jal", "bltu",
     "bgeu", "lbu", "lhu", "lwu", "sltiu", "sltu", "slliw", "srliw", "sraiw", "addw",
-    "subw", "sllw", "srlw", "sraw", "nop", "", ""
+    "subw", "sllw", "srlw", "sraw", "nop", "mulhsu", "mulhu", "divu", "remu", "mulw",
+    "divw", "divuw", "remw", "remuw", "flw", "fld", "fsw", "fsd", "fmadd.s", "fmadd.d",
+    "fmsub.s", "fmsub.d", "fnmsub.s", "fnmsub.d", "fnmadd.s", "fnmadd.d", "fadd.s", "fadd.d", "fsub.s", "fsub.d",
+    "fmul.s", "fmul.d", "fdiv.s", "fdiv.d", "fsqrt.s", "fsqrt.d", "fsgnj.s", "fsgnj.d", "fsgnjn.s", "fsgnjn.d",
+    "fsgnjx.s", "fsgnjx.d", "fmin.s", "fmin.d", "fmax.s", "fmax.d", "fcvt.s.d", "fcvt.d.s", "feq.s", "feq.d",
+    "flt.s", "flt.d", "fle.s", "fle.d", "fcvt.w.s", "fcvt.w.d", "fcvt.wu.s", "fcvt.wu.d", "fcvt.l.s", "fcvt.l.d",
+    "fcvt.lu.s", "fcvt.lu.d", "fcvt.s.w", "fcvt.d.w", "fcvt.s.wu", "fcvt.d.wu", "fcvt.s.l", "fcvt.d.l", "fcvt.s.lu", "fcvt.d.lu",
+    "fmv.x.w", "fmv.x.d", "fclass.s", "fclass.d", "fmv.w.x", "fmv.d.x", "csrrw", "csrrs", "csrrc", "csrrwi",
+    "csrrsi", "csrrci", "lr.w", "lr.d", "sc.w", "sc.d", "amoswap.w", "amoswap.d", "amoadd.w", "amoadd.d",
+    "amoxor.w", "amoxor.d", "amoand.w", "amoand.d", "amoor.w", "amoor.d", "amomin.w", "amomin.d", "amomax.w", "amomax.d",
+    "amominu.w", "amominu.d", "amomaxu.w", "amomaxu.d", "fence", "fence.i", "vsetvli", "vsetivli", "vsetvl", "vle",
+    "vse", "vlse", "vsse", "vadd.vv", "vadd.vx", "vadd.vi", "vsub.vv", "vsub.vx", "vmul.vv", "vmul.vx",
+    "vmacc.vv", "vmacc.vx", "vredsum.vs", "vmv.v.v", "vmv.v.x", "vmv.v.i", "vmv.x.s"
 };
 
-const char *regName_cstr[33] = {
+const char *regName_cstr[REG_NUM + FREG_NUM] = {
     "ZR ", "RA ", "SP ", "GP ", "TP ", "T0 ", "T1 ", "T2 ", "S0 ", "S1 ", 
     "A0 ", "A1 ", "A2 ", "A3 ", "A4 ", "A5 ", "A6 ", "A7 ", "S2 ", "S3 ",  
     "S4 ", "S5 ", "S6 ", "S7 ", "S8 ", "S9 ", "S10", "S11", "T3 ", "T4 ",  
-    "T5 ", "T6 "
+    "T5 ", "T6 ",
+    "FT0", "FT1", "FT2", "FT3", "FT4", "FT5", "FT6", "FT7", "FS0", "FS1",
+    "FA0", "FA1", "FA2", "FA3", "FA4", "FA5", "FA6", "FA7", "FS2", "FS3",
+    "FS4", "FS5", "FS6", "FS7", "FS8", "FS9", "FS10", "FS11", "FT8", "FT9",
+    "FT10", "FT11"
 };
 
 const char *pscmName[10] = {
-    "Always Taken", "Always Not Taken", "Bimodal", "Self Adjustment"
+    "Always Taken", "Always Not Taken", "Bimodal", "Self Adjustment", "GShare", "Tournament", "TAGE-SC-L", "Hashed Perceptron"
 };
 
 
@@ -392,15 +962,33 @@ Machine::PfmConfig(FILE *f){
     fflush(stdout);
     char buf[600 + 10];
     char *retVal = buf;
-    const char *L1_Latency = "L1_Latency";
+    const char *L1_Latency = "L1_Latency";     /*sets both L1I and L1D*/
     const char *L1_Config = "L1_Config";
+    const char *L1I_Latency = "L1I_Latency";
+    const char *L1I_Config = "L1I_Config";
+    const char *L1D_Latency = "L1D_Latency";
+    const char *L1D_Config = "L1D_Config";
     const char *L2_Latency = "L2_Latency";
     const char *L2_Config = "L2_Config";
     const char *LLC_Latency = "LLC_Latency";
     const char *LLC_Config = "LLC_Config";
+    const char *Sweep_Config = "Sweep_Config";
     const char *Mem_Latency = "Mem_Latency";
+    const char *VLEN = "VLEN";
+    const char *GShare_Config = "GShare_Config";
+    const char *Tournament_Config = "Tournament_Config";
+    const char *TAGE_Config = "TAGE_Config";
+    const char *Perceptron_Config = "Perceptron_Config";
+    const char *BTB_Config = "BTB_Config";
+    const char *RAS_Config = "RAS_Config";
+    const char *ITTAGE_Config = "ITTAGE_Config";
+    const char *FTQ_Config = "FTQ_Config";
+    const char *FDIP = "FDIP";
+    const char *Issue_Config = "Issue_Config";
+    const char *OOO_Config = "OOO_Config";
+    const char *FU = "FU";
 
-    for(int i = 0; i < INSTRNUM + 100; i++){
+    while(true){
         retVal = fgets(buf, 600, f);
         if(retVal == NULL)
             break;
@@ -413,19 +1001,45 @@ Machine::PfmConfig(FILE *f){
         int performance = 1;
 
         sscanf(buf, "%s %d", instName, &performance);
+        if(instName[0] == '\0')
+            continue;
 
-        for(int k = 0; k < 54; k++)
-            if(strcmp(instName, instrName_cstr[k]) == 0){
+        /*keep the line for the stats dump, a repeated key keeps the last*/
+        char *rest = strstr(buf, instName) + strlen(instName);
+        while(*rest == ' ' || *rest == '\t')
+            rest ++;
+        int restLen = strcspn(rest, "\r\n");
+        while(restLen > 0 && (rest[restLen - 1] == ' ' || rest[restLen - 1] == '\t'))
+            restLen --;
+        string value(rest, restLen);
+        /*keys that may repeat are told apart, FU by unit name and sweeps by number*/
+        string key(instName);
+        if(strcmp(instName, FU) == 0)
+            key += "." + value.substr(0, value.find(' '));
+        else if(strcmp(instName, Sweep_Config) == 0)
+            key += "." + to_string(sweepConfigs.size());
+        stats.Config(key, value);
+
+        for(int k = 0; k < INSTRNUM; k++)
+            if(instrName_cstr[k] != NULL && strcmp(instName, instrName_cstr[k]) == 0){
                 instId = k;
                 break;
             }
 
-        if(strcmp(L1_Latency, instName) == 0){
+        if(strcmp(L1_Latency, instName) == 0 || strcmp(L1I_Latency, instName) == 0 ||
+           strcmp(L1D_Latency, instName) == 0){
             int hit_lat = 0, bus_lat = 0;
             sscanf(buf, "%s %d %d", instName, &hit_lat, &bus_lat);
-            L1_latency.hit_latency = hit_lat;
-            L1_latency.bus_latency = bus_lat;
-            printf("L1 hit:%d bus:%d\n", hit_lat, bus_lat);
+            if(strcmp(L1D_Latency, instName) != 0){
+                L1I_latency.hit_latency = hit_lat;
+                L1I_latency.bus_latency = bus_lat;
+                printf("L1I hit:%d bus:%d\n", hit_lat, bus_lat);
+            }
+            if(strcmp(L1I_Latency, instName) != 0){
+                L1D_latency.hit_latency = hit_lat;
+                L1D_latency.bus_latency = bus_lat;
+                printf("L1D hit:%d bus:%d\n", hit_lat, bus_lat);
+            }
         }
         else if(strcmp(L2_Latency, instName) == 0){
             int hit_lat = 0, bus_lat = 0;
@@ -448,20 +1062,168 @@ Machine::PfmConfig(FILE *f){
             Memory_latency.bus_latency = bus_lat;
             printf("Memory hit:%d bus:%d\n", hit_lat, bus_lat);
         }
-        else if(strcmp(L1_Config, instName) == 0){
+        else if(strcmp(VLEN, instName) == 0){
+            if(performance < 64 || performance > VLEN_MAX || (performance & (performance - 1)) != 0){
+                printf("VLEN should be a power of 2 between 64 and %d!\n", VLEN_MAX);
+                ASSERT(false);
+            }
+            vlen = performance;
+            printf("VLEN:%d\n", vlen);
+        }
+        else if(strcmp(GShare_Config, instName) == 0){
+            MyPred.SetGShare(performance);
+            printf("GShare history bits:%d\n", performance);
+        }
+        else if(strcmp(Tournament_Config, instName) == 0){
+            int localBits = TOUR_LOCAL_BITS, localHisBits = TOUR_LOCALHIS_BITS;
+            int globalBits = TOUR_GLOBAL_BITS;
+            sscanf(buf, "%s %d %d %d", instName, &localBits, &localHisBits, &globalBits);
+            MyPred.SetTournament(localBits, localHisBits, globalBits);
+            printf("Tournament local:%d local history:%d global history:%d\n",
+                    localBits, localHisBits, globalBits);
+        }
+        else if(strcmp(TAGE_Config, instName) == 0){
+            int budgetKB = TAGE_BUDGET_KB, tables = TAGE_TABLES;
+            sscanf(buf, "%s %d %d", instName, &budgetKB, &tables);
+            if(budgetKB < 4 || tables < 2 || tables > TAGE_MAX_TABLES){
+                printf("TAGE needs at least 4KB and 2 to %d tables!\n", TAGE_MAX_TABLES);
+                ASSERT(false);
+            }
+            MyPred.SetTage(budgetKB, tables);
+            printf("TAGE-SC-L budget:%dKB tables:%d entries:%d storage:%.1fKB\n", budgetKB, tables,
+                    1 << MyPred.tage.logSize, MyPred.tage.storageBits / 8192.0);
+        }
+        else if(strcmp(Perceptron_Config, instName) == 0){
+            int rowBits = PERC_ROW_BITS, histLen = PERC_HIST;
+            sscanf(buf, "%s %d %d", instName, &rowBits, &histLen);
+            if(rowBits < 1 || rowBits > 16 || histLen < 1 || histLen > PERC_MAX_HIST){
+                printf("Perceptron needs 1 to 16 row bits and 1 to %d history!\n", PERC_MAX_HIST);
+                ASSERT(false);
+            }
+            MyPred.SetPerceptron(rowBits, histLen);
+            printf("Perceptron rows:%d history:%d storage:%.1fKB\n", 1 << rowBits,
+                    MyPred.perc.histLen, ((MyPred.perc.histLen + 1) << rowBits) / 1024.0);
+        }
+        else if(strcmp(BTB_Config, instName) == 0){
+            int setBits = BTB_BITS, ways = BTB_WAYS;
+            sscanf(buf, "%s %d %d", instName, &setBits, &ways);
+            if(setBits < 0 || setBits > 20 || ways < 1){
+                printf("Please give proper BTB config!\n");
+                ASSERT(false);
+            }
+            MyPred.targets.SetBtb(setBits, ways);
+            printf("BTB sets:%d ways:%d\n", 1 << setBits, ways);
+        }
+        else if(strcmp(RAS_Config, instName) == 0){
+            if(performance < 1){
+                printf("Please give proper RAS config!\n");
+                ASSERT(false);
+            }
+            MyPred.targets.SetRas(performance);
+            printf("RAS depth:%d\n", performance);
+        }
+        else if(strcmp(ITTAGE_Config, instName) == 0){
+            int bits = ITTAGE_BITS, tables = ITTAGE_TABLES;
+            sscanf(buf, "%s %d %d", instName, &bits, &tables);
+            if(bits < 1 || bits > 20 || tables < 1 || tables > ITTAGE_MAX_TABLES){
+                printf("Please give proper ITTAGE config!\n");
+                ASSERT(false);
+            }
+            MyPred.targets.SetIttage(bits, tables);
+            printf("ITTAGE entries:%d tables:%d\n", 1 << bits, tables);
+        }
+        else if(strcmp(FTQ_Config, instName) == 0){
+            int entries = FTQ_ENTRIES, block = FETCH_BLOCK;
+            sscanf(buf, "%s %d %d", instName, &entries, &block);
+            if(entries < 1 || block < 4 || block > BLOCK_SIZE || (block & (block - 1)) != 0){
+                printf("Please give proper FTQ config!\n");
+                ASSERT(false);
+            }
+            ftqEntries = entries;
+            fetchBlock = block;
+            printf("FTQ entries:%d fetch block:%d bytes\n", entries, block);
+        }
+        else if(strcmp(Issue_Config, instName) == 0){
+            int width = 1, alu = -1, mul = 1, mem = 1;
+            sscanf(buf, "%s %d %d %d %d", instName, &width, &alu, &mul, &mem);
+            if(alu < 0)
+                alu = width;
+            if((width != 1 && width != 2 && width != 4) || alu < 1 || mul < 1 || mem < 1){
+                printf("Please give proper issue config!\n");
+                ASSERT(false);
+            }
+            issueWidth = width;
+            issueAlu = alu;
+            issueMul = mul;
+            issueMem = mem;
+            printf("Issue width:%d alu:%d mul:%d mem:%d\n", width, alu, mul, mem);
+        }
+        else if(strcmp(FU, instName) == 0){
+            /*FU name count latency ii class...*/
+            char name[40] = {};
+            int count = 0, latency = -1, ii = -1, used = 0;
+            sscanf(buf, "%s %39s %d %d %d%n", instName, name, &count, &latency, &ii, &used);
+            unsigned classes = 0;
+            char cls[40];
+            int n = 0;
+            for(char *p = buf + used; used > 0 && sscanf(p, "%39s%n", cls, &n) == 1; p += n){
+                int op = Scoreboard::OpClassByName(cls);
+                if(op < 0){
+                    printf("unknown op class %s, use int mul div fp fdiv load store vec\n", cls);
+                    ASSERT(false);
+                }
+                classes |= 1u << op;
+            }
+            if(count < 1 || latency < 0 || ii < 0 || classes == 0){
+                printf("Please give proper FU config!\n");
+                ASSERT(false);
+            }
+            sboard.AddUnit(name, count, latency, ii, classes);
+            printf("FU %s count:%d latency:%d ii:%d\n", name, count, latency, ii);
+        }
+        else if(strcmp(OOO_Config, instName) == 0){
+            int width = OOO_WIDTH, rob = OOO_ROB, iq = OOO_IQ, lsq = OOO_LSQ, pregs = OOO_PREGS;
+            int queues = 1, alu = -1, mul = 1, mem = 2;
+            sscanf(buf, "%s %d %d %d %d %d %d %d %d %d", instName, &width, &rob, &iq, &lsq, &pregs,
+                   &queues, &alu, &mul, &mem);
+            if(alu < 0)
+                alu = width;
+            if(width < 1 || rob < 1 || iq < 1 || lsq < 1 || pregs <= OOO_ARCH_REGS ||
+               (queues != 1 && queues != FuClassNum) || alu < 1 || mul < 1 || mem < 1){
+                printf("Please give proper OOO config!\n");
+                ASSERT(false);
+            }
+            ooo.Init(width, rob, iq, lsq, pregs, queues != 1, alu, mul, mem);
+            printf("OOO width:%d ROB:%d IQ:%d x %d LSQ:%d pregs:%d alu:%d mul:%d mem:%d\n",
+                   width, rob, iq, queues, lsq, pregs, alu, mul, mem);
+        }
+        else if(strcmp(FDIP, instName) == 0){
+            fdip = performance != 0;
+            printf("Fetch-directed prefetch:%s\n", fdip ? "on" : "off");
+        }
+        else if(strcmp(L1_Config, instName) == 0 || strcmp(L1I_Config, instName) == 0 ||
+                strcmp(L1D_Config, instName) == 0){
             int conf_size, conf_associa, conf_wt, conf_wa;
+            CacheConfig cc;
             sscanf(buf, "%s %d %d %d %d", 
                 instName , &conf_size, &conf_associa, &conf_wt, &conf_wa);
-            L1_config.size = conf_size;
-            L1_config.associativity = conf_associa;
-            L1_config.set_num = L1_config.size / (L1_config.associativity * BLOCK_SIZE);
-            if(L1_config.size % (L1_config.associativity * BLOCK_SIZE) != 0){
+            cc.size = conf_size;
+            cc.associativity = conf_associa;
+            cc.set_num = cc.size / (cc.associativity * BLOCK_SIZE);
+            if(cc.size % (cc.associativity * BLOCK_SIZE) != 0){
                 printf("Please give proper cache config!\n");
                 ASSERT(false);
             }
-            L1_config.write_through = conf_wt;
-            L1_config.write_allocate = conf_wa;
-            printf("L1 size:%d associativity:%d\n", conf_size, conf_associa);
+            cc.write_through = conf_wt;
+            cc.write_allocate = conf_wa;
+            if(strcmp(L1D_Config, instName) != 0){
+                L1I_config = cc;
+                printf("L1I size:%d associativity:%d\n", conf_size, conf_associa);
+            }
+            if(strcmp(L1I_Config, instName) != 0){
+                L1D_config = cc;
+                printf("L1D size:%d associativity:%d\n", conf_size, conf_associa);
+            }
         }
         else if(strcmp(L2_Config, instName) == 0){
             int conf_size, conf_associa, conf_wt, conf_wa;
@@ -493,6 +1255,27 @@ Machine::PfmConfig(FILE *f){
             LLC_config.write_allocate = conf_wa;
             printf("LLC size:%d associativity:%d\n", conf_size, conf_associa);
         }
+        else if(strcmp(Sweep_Config, instName) == 0){
+            int conf_size, conf_associa, conf_wt, conf_wa;
+            char engine[16] = "lru";
+            CacheConfig cc;
+            sscanf(buf, "%s %d %d %d %d %15s", 
+                instName , &conf_size, &conf_associa, &conf_wt, &conf_wa, engine);
+            cc.size = conf_size;
+            cc.associativity = conf_associa;
+            cc.set_num = cc.size / (cc.associativity * BLOCK_SIZE);
+            if(cc.size % (cc.associativity * BLOCK_SIZE) != 0 || (cc.set_num & (cc.set_num - 1)) != 0){
+                printf("Please give proper cache config!\n");
+                ASSERT(false);
+            }
+            cc.write_through = conf_wt;
+            cc.write_allocate = conf_wa;
+            if(strcmp(engine, "lru") != 0 && strcmp(engine, "cache") != 0){
+                printf("Sweep_Config engine is lru or cache, not %s\n", engine);
+                ASSERT(false);
+            }
+            sweepConfigs.push_back(std::make_pair(cc, strcmp(engine, "cache") == 0));
+        }
         else
             instrPfm[instId] = performance;
     }
@@ -502,8 +1285,8 @@ Machine::PfmConfig(FILE *f){
 void 
 Machine::Halt(){
     machineStats.edTime = clock();
-    int misP = machineStats.misPrediction;
-    int sucP = machineStats.sucPrediction;
+    long long misP = machineStats.misPrediction;
+    long long sucP = machineStats.sucPrediction;
     
     double acc = 0;
     if(misP + sucP > 0)
@@ -512,39 +1295,135 @@ Machine::Halt(){
 
     double secs = (double)(machineStats.edTime - machineStats.stTime) / CLOCKS_PER_SEC;
     printf("Machine halting!\n");
+    if(brTrace != NULL)
+        brTrace->Close(machineStats.instrCnt);
+    if(intervals != NULL){
+        intervals->Close(intervalCounters());
+        printf("Interval samples written:           %lld\n", intervals->samples);
+    }
+    if(profiler != NULL && profiler->Write(profilePath.c_str(), programPath.c_str(), timing->Cycles()))
+        printf("Profiled PCs:                       %llu\n", (unsigned long long)profiler->pcs);
+    if(reuse != NULL && reuse->Write(reusePath.c_str()))
+        printf("Reuse distances of:                 %llu accesses\n", (unsigned long long)reuse->accesses);
+    if(sweep != NULL && sweep->Write(sweepPath.c_str()))
+        printf("Cache configs swept:                %zu over %lld accesses\n",
+                sweep->configs.size(), sweep->accesses);
     printf("----------STATS----------------------------\n");
-    printf("Pipline Cycles:                     %d\n", machineCycle);
-    printf("Total Ticks (cpu cycle):          %d\n", machineStats.cycle);
+    printf("Pipline Cycles:                     %lld\n", machineCycle);
+    printf("Total Ticks (cpu cycle):          %llu\n", (unsigned long long)timing->Cycles());
     printf("Program CPI:                        %.4f\n", 
-            (double)machineStats.cycle / machineStats.instrCnt);
-    printf("Instr:                              %d\n", machineStats.instrCnt); 
+            (double)timing->Cycles() / machineStats.instrCnt);
+    printf("Instr:                              %lld\n", machineStats.instrCnt); 
     printf("Seconds:                            %.4f\n", secs);
-    printf("Data forwarding:                    %d\n", machineStats.dataHazard);
-    printf("Load-use hazard:                    %d\n", machineStats.loadUseHazard);
-    printf("Control hazard:                     %d\n", machineStats.controlHazard);
+    printf("Data forwarding:                    %lld\n", machineStats.dataHazard);
+    printf("Load-use hazard:                    %lld\n", machineStats.loadUseHazard);
+    printf("Control hazard:                     %lld\n", machineStats.controlHazard);
+    printf("Slowest-stage ticks:                %lld\n", machineStats.cycle);
+    if(!oooModel){
+        printf("Issue held by fetch/operand/WAW:    %lld / %lld / %lld\n",
+                sboard.fetchStall, sboard.rawStall, sboard.wawStall);
+        printf("Issue held by unit/serialize:       %lld / %lld\n", sboard.unitStall, sboard.serialStall);
+        printf("CPI stack:                          cycles / CPI / share\n");
+        for(int i = -1; i < CpiFieldNum; i++){
+            long long c = i < 0 ? sboard.CpiBase() : sboard.cpiStall[i];
+            printf("  %-32s %lld / %.4f / %.2f%%\n", i < 0 ? "base" : Scoreboard::CpiName(i), c,
+                    machineStats.instrCnt > 0 ? (double)c / machineStats.instrCnt : 0.0,
+                    sboard.Cycles() > 0 ? 100.0 * c / sboard.Cycles() : 0.0);
+        }
+    }
+    for(size_t i = 0; i < timing->fus.size(); i++){
+        const FuncUnit &f = timing->fus[i];
+        uint64_t cap = timing->Cycles() * f.count;
+        printf("  FU %-6s x%d  ops:%-10lld utilization:%.4f\n", f.name.c_str(), f.count, f.ops,
+                cap > 0 ? (double)f.busy / cap : 0.0);
+    }
+    if(issueWidth > 1){
+        printf("Issue width:                        %d (alu %d, mul %d, mem %d)\n",
+                issueWidth, issueAlu, issueMul, issueMem);
+        printf("  Instr issued per cycle:          ");
+        for(int i = 0; i <= issueWidth; i++)
+            printf(" %d:%lld", i, machineStats.issueHist[i]);
+        printf("\n  Groups cut by dependency / unit:  %lld / %lld\n",
+                machineStats.groupDep, machineStats.groupFu);
+    }
+    if(oooModel){
+        printf("Out-of-order core:                  width %d, ROB %d, IQ %d%s, LSQ %d, %d pregs\n",
+                ooo.width, ooo.robSize, ooo.iqSize, ooo.distributed ? " per class" : "",
+                ooo.lsqSize, ooo.pregNum);
+        printf("  Cycles:                           %llu (IPC %.4f)\n", (unsigned long long)ooo.cycles,
+                ooo.cycles > 0 ? (double)ooo.instrs / ooo.cycles : 0.0);
+        printf("  Dispatch stalls ROB/IQ/LSQ/reg:   %lld / %lld / %lld / %lld\n",
+                ooo.robFull, ooo.iqFull, ooo.lsqFull, ooo.regFull);
+        printf("  Fetch buffer full / serialize:    %lld / %lld\n", ooo.frontFull, ooo.serialStall);
+        printf("  Store-to-load forwards:           %lld\n", ooo.forwards);
+        printf("  Mispredicts / squashed instr:     %lld / %lld\n", ooo.mispredicts, ooo.squashed);
+    }
     printf("Branch prediction scheme:           %s\n", pscmName[MyPred.predScm]);
-    printf("Branch prediction Acc:              %.3f (%d / %d)\n", acc, sucP, (misP + sucP));
-    printf("ECALL num:                          %d\n", machineStats.ecallNum);
-    printf("FSTALL num:                         %d\n", machineStats.FSTALL);
+    printf("Branch prediction Acc:              %.3f (%lld / %lld)\n", acc, sucP, (misP + sucP));
+    printf("Jalr target prediction:             %.3f (%lld / %lld)\n",
+            machineStats.jalrCnt > 0 ? (double)machineStats.jalrPredicted / machineStats.jalrCnt : 0.0,
+            machineStats.jalrPredicted, machineStats.jalrCnt);
+    printf("  RAS pops:                         %lld (%lld correct, %lld overflow, %lld underflow)\n",
+            MyPred.targets.rasPop, MyPred.targets.rasCorrect, MyPred.targets.rasOverflow, MyPred.targets.rasUnderflow);
+    printf("  BTB hit rate:                     %.3f (%lld / %lld, %lld correct)\n",
+            MyPred.targets.btbLookup > 0 ? (double)MyPred.targets.btbHit / MyPred.targets.btbLookup : 0.0,
+            MyPred.targets.btbHit, MyPred.targets.btbLookup, MyPred.targets.btbCorrect);
+    printf("  ITTAGE hit rate:                  %.3f (%lld / %lld, %lld correct)\n",
+            MyPred.targets.ittLookup > 0 ? (double)MyPred.targets.ittHit / MyPred.targets.ittLookup : 0.0,
+            MyPred.targets.ittHit, MyPred.targets.ittLookup, MyPred.targets.ittCorrect);
+    printf("Branch BTB hit rate:                %.3f (%lld / %lld)\n",
+            MyPred.btbBrLookup > 0 ? (double)MyPred.btbBrHit / MyPred.btbBrLookup : 0.0,
+            MyPred.btbBrHit, MyPred.btbBrLookup);
+    printf("ECALL num:                          %lld\n", machineStats.ecallNum);
+    printf("FSTALL num:                         %lld\n", machineStats.FSTALL);
+
+    long long fetchedInstr = machineStats.fetchBytes > 0 ?
+        (machineStats.fetchBytes - 2 * machineStats.compressedCnt) / 4 + machineStats.compressedCnt : 0;
+    printf("\nInstruction fetch accesses:         %lld (%lld straddling a line)\n",
+            machineStats.fetchAccess, machineStats.straddleFetch);
+    printf("Fetch blocks:                       %lld (%.2f instr/block, FTQ %d x %dB)\n",
+            machineStats.fetchBlocks,
+            machineStats.fetchBlocks > 0 ? (double)fetchedInstr / machineStats.fetchBlocks : 0.0,
+            ftqEntries, fetchBlock);
+    printf("FTQ empty / full cycles:            %lld / %lld\n", machineStats.ftqEmpty, machineStats.ftqFull);
+    if(fdip)
+        printf("Fetch-directed prefetches:          %lld\n", machineStats.fdipPrefetch);
+    printf("Instruction bytes fetched:          %lld (%.3f bytes/instr)\n", machineStats.fetchBytes,
+            fetchedInstr > 0 ? (double)machineStats.fetchBytes / fetchedInstr : 0.0);
+    printf("Compressed instr fetched:           %lld (%.2f%%)\n", machineStats.compressedCnt,
+            fetchedInstr > 0 ? 100.0 * machineStats.compressedCnt / fetchedInstr : 0.0);
+    printf("Atomic memory operations:           %lld (%lld sc failed)\n",
+            machineStats.atomicCnt, machineStats.scFail);
+    printf("Vector instr:                       %lld (VLEN %d, %lld line accesses)\n",
+            machineStats.vecInstr, vlen, machineStats.vecMemAccess);
 
     StorageStats s;
-    L1.GetStats(s);
-    printf("\nCache L1 miss rate:%.4f (%d / %d)  access_time:%d cycle\n",
+    L1I.GetStats(s);
+    printf("\nCache L1I miss rate:%.4f (%lld / %lld)  access_time:%lld cycle\n",
+     (double)s.miss_num / (double)s.access_counter, s.miss_num, s.access_counter, s.access_time);
+    if(s.prefetch_num > 0)
+        printf("  prefetched lines:%lld\n", s.prefetch_num);
+
+    L1D.GetStats(s);
+    printf("\nCache L1D miss rate:%.4f (%lld / %lld)  access_time:%lld cycle\n",
      (double)s.miss_num / (double)s.access_counter, s.miss_num, s.access_counter, s.access_time);
 
     L2.GetStats(s);
-    printf("\nCache L2 miss rate:%.4f (%d / %d)  access_time:%d cycle\n",
+    printf("\nCache L2 miss rate:%.4f (%lld / %lld)  access_time:%lld cycle\n",
      (double)s.miss_num / (double)s.access_counter, s.miss_num, s.access_counter, s.access_time);
 
     LLC.GetStats(s);
-    printf("\nCache LLC miss rate:%.4f (%d / %d)  access_time:%d cycle\n",
+    printf("\nCache LLC miss rate:%.4f (%lld / %lld)  access_time:%lld cycle\n",
      (double)s.miss_num / (double)s.access_counter, s.miss_num, s.access_counter, s.access_time);
 
     PhyMem.GetStats(s);
     StorageLatency tmpl;
     PhyMem.GetLatency(tmpl);
-    printf("\nPhysical memory access_counter:%d access_time:%d cycle\n\n",
+    printf("\nPhysical memory access_counter:%lld access_time:%lld cycle\n\n",
          s.access_counter, s.access_time);
+
+    if(!statsFile.empty() && stats.Dump(statsFile.c_str(), statsCsv))
+        printf("Stats written to %s\n", statsFile.c_str());
     exit(0);
 }
 
@@ -573,83 +1452,47 @@ Machine::printPipe(){
     else
         printf("Fetch:     PC:%llx\n", this->PC);
 
-    if(DReg.bubble)
-        printf("Decode: \n-BUBBLE-\n");
-    else if(DReg.stall)
-        printf("Decode: \n-STALL-\n");
-    else
-        printf("Decode:    [%llx] instr:%s\n", 
-            ERegO.instr.addr, instrName_cstr[ERegO.instr.name]);
+    for(int l = 0; l < issueWidth; l++){
+        if(DReg[l].bubble)
+            printf("Decode: \n-BUBBLE-\n");
+        else if(ERegO[l].bubble)
+            printf("Decode: \n-STALL-\n");
+        else
+            printf("Decode:    [%llx] instr:%s\n", 
+                ERegO[l].instr.addr, instrName_cstr[ERegO[l].instr.name]);
+    }
 
-    if(EReg.bubble)
-        printf("Execute: \n-BUBBLE-\n");
-    else if(EReg.stall)
-        printf("Execute: \n-STALL-\n");
-    else
-        printf("Execute:   [%llx] instr:%s valE:%llx valC:%llx\n", 
-            MRegO.instr.addr, instrName_cstr[EReg.instr.name], MRegO.valE, MRegO.valC);
+    for(int l = 0; l < issueWidth; l++){
+        if(EReg[l].bubble || MRegO[l].bubble)
+            printf("Execute: \n-BUBBLE-\n");
+        else
+            printf("Execute:   [%llx] instr:%s valE:%llx valC:%llx\n", 
+                MRegO[l].instr.addr, instrName_cstr[EReg[l].instr.name], MRegO[l].valE, MRegO[l].valC);
+    }
 
-    if(MReg.bubble)
-        printf("MemStage: \n-BUBBLE-\n");
-    else if(MReg.stall)
-        printf("MemStage: \n-STALL-\n");
-    else
-        printf("MemStage:    [%llx] instr:%s valM:%llx valE:%llx\n", 
-            WRegO.instr.addr, instrName_cstr[MReg.instr.name], WRegO.valM, WRegO.valE);
+    for(int l = 0; l < issueWidth; l++){
+        if(MReg[l].bubble)
+            printf("MemStage: \n-BUBBLE-\n");
+        else
+            printf("MemStage:    [%llx] instr:%s valM:%llx valE:%llx\n", 
+                WRegO[l].instr.addr, instrName_cstr[MReg[l].instr.name], WRegO[l].valM, WRegO[l].valE);
+    }
 
-    if(WReg.bubble)
-        printf("Writeback: \n-BUBBLE-\n");
-    else if(WReg.stall)
-        printf("Writeback: \n-STALL-\n");
-    else
-        printf("Writeback: [%llx] instr:%s dstM:%s dstE:%s\n",
-            WReg.instr.addr, instrName_cstr[WReg.instr.name], regName_cstr[WReg.dstM], regName_cstr[WReg.dstE]);
+    for(int l = 0; l < issueWidth; l++){
+        if(WReg[l].bubble)
+            printf("Writeback: \n-BUBBLE-\n");
+        else
+            printf("Writeback: [%llx] instr:%s dstM:%s dstE:%s\n",
+                WReg[l].instr.addr, instrName_cstr[WReg[l].instr.name], regName_cstr[WReg[l].dstM], regName_cstr[WReg[l].dstE]);
+    }
 }
 
 void
 Machine::printSingleStep(){
     char buf[20];
 
-    uint64_t addr = 0;printf("*****PIPLINE*****\n");
-                fflush(stdout);
-                if(FReg.bubble)
-                    printf("Fetch: \n-BUBBLE-\n");
-                else if(FReg.stall)
-                    printf("Fetch: \n-STALL-\n");
-                else
-                    printf("Fetch:     PC:%llx\n", this->PC);
-
-                if(DReg.bubble)
-                    printf("Decode: \n-BUBBLE-\n");
-                else if(DReg.stall)
-                    printf("Decode: \n-STALL-\n");
-                else
-                    printf("Decode:    [%llx] instr:%s\n", 
-                        ERegO.instr.addr, instrName_cstr[ERegO.instr.name]);
-
-                if(EReg.bubble)
-                    printf("Execute: \n-BUBBLE-\n");
-                else if(FReg.stall)
-                    printf("Execute: \n-STALL-\n");
-                else
-                    printf("Execute:   [%llx] instr:%s valE:%llx valC:%llx\n", 
-                        MRegO.instr.addr, instrName_cstr[EReg.instr.name], MRegO.valE, MReg.valC);
-
-                if(MReg.bubble)
-                    printf("MemStage: \n-BUBBLE-\n");
-                else if(FReg.stall)
-                    printf("MemStage: \n-STALL-\n");
-                else
-                    printf("MemStage:    [%llx] instr:%s valM:%llx valE:%llx\n", 
-                        WRegO.instr.addr, instrName_cstr[MReg.instr.name], WRegO.valM, WRegO.valE);
-
-                if(WReg.bubble)
-                    printf("Writeback: \n-BUBBLE-\n");
-                else if(FReg.stall)
-                    printf("Writeback: \n-STALL-\n");
-                else
-                    printf("Writeback: [%llx] instr:%s dstM:%llx dstE:%llx\n",
-                        WReg.instr.addr, instrName_cstr[WReg.instr.name], WReg.dstM, WReg.dstE);
+    uint64_t addr = 0;
+    printPipe();
     int size = 0;
     char c;
     int64_t memVal = 0;
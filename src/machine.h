@@ -5,18 +5,35 @@
 #include "pred.h"
 #include "memory.h"
 #include "cache.h"
+#include "vector.h"
+#include "target.h"
+#include "brtrace.h"
+#include "ooo.h"
+#include "scoreboard.h"
+#include "stats.h"
+#include "interval.h"
+#include "profile.h"
+#include "reuse.h"
+#include "sweep.h"
 #include <time.h>
 #include <stdio.h>
 #include <map>
+#include <vector>
 
 #define REG_NUM 32
+#define FREG_NUM 32
+#define FREG_BASE REG_NUM   /*f0 is registers[FREG_BASE] in the pipeline*/
 #define PAGE_SIZE 4096
 #define PYS_PAGE_NUM 1024
 #define MEM_SIZE (PAGE_SIZE * PYS_PAGE_NUM)
 #define STACK_PAGES 10
 
+#define MAX_ISSUE 4         //widest in-order issue group
+#define FTQ_ENTRIES 8       //default fetch target queue depth
+#define FETCH_BLOCK 16      //default fetch block bytes, at most a cache line
+
 /*instruction num -- a little more than real*/
-#define INSTRNUM 60
+#define INSTRNUM 200
 /*read write num*/
 #define WRNUM 10
 #define RMEM 1
@@ -42,10 +59,11 @@ typedef struct{
 /*Instruction*/
 typedef struct{
     uint64_t addr;
-    uint32_t ival;
+    uint32_t ival;  /*compressed instructions are expanded to 32 bits*/
     uint32_t opcode;
     int name;
     int type;
+    int len;        /*2 for compressed instructions, 4 otherwise*/
 }Instruction;
 
 /*pipline register*/
@@ -53,33 +71,87 @@ typedef struct{
     Instruction instr;
     int64_t srcA;   /*rs1*/
     int64_t srcB;   /*rs2*/
+    int64_t srcC;   /*rs3, fused multiply-add only*/
     int64_t valA;   /*reg[rs1]*/
     int64_t valB;   /*reg[rs2]*/
     int64_t valC;
+    int64_t valD;   /*reg[rs3]*/
     int64_t valE;   /*ALU result*/
     int64_t valM;   /*value from memory waiting to be written into register*/
     int64_t imm;    /*imm[:]*/
     int64_t dstE;
     int64_t dstM;
 
+    int64_t vl;     /*vector config seen by this instruction in Execute*/
+    int64_t vtype;
+
     bool predJ;     /*branch prediction*/
+    PredMeta predMeta;  /*what the predictor used for predJ or the jalr target*/
+    PredCkpt predCkpt;  /*front-end state after this instruction was fetched*/
+    int fetchLat;       /*I-cache time, on the first instr of a block*/
+    int memLat;         /*cache time in MemStage*/
+    int fetchMiss;      /*L1I misses, like fetchLat*/
+    int memMiss;        /*L1D misses in MemStage*/
+    int memLevel;       /*and the deepest level missed, see OooInstr*/
+    bool mispredict;    /*Execute redirected the front end*/
     bool bubble;
     bool stall;
 }PipReg;
 
+/*one instruction of a fetch block and what the predictor said about it*/
+typedef struct{
+    Instruction instr;  /*addr, len and ival, decoded later*/
+    bool predJ;
+    PredMeta predMeta;
+    PredCkpt predCkpt;  /*predictor state after this instruction*/
+}FtqSlot;
+
+/*
+    Fetch target queue entry: sequential instructions inside one cache
+    line, ending early at a predicted taken branch or jump.
+*/
+typedef struct{
+    uint64_t start;
+    int bytes;
+    uint64_t next;      /*predicted address of the following block*/
+    bool fetched;       /*I-cache read done*/
+    int fetchLat;       /*its time and misses, handed out with the first instr*/
+    int fetchMiss;
+    long long prefetchReady;    /*machineCycle its prefetched lines arrive, 0 if none*/
+    int slotNum;
+    std::vector<FtqSlot> slots;
+}FtqEntry;
+
 /*machine stats*/
 typedef struct{
-    int cycle;
-    int instrCnt;
-    int dataHazard;
-    int loadUseHazard;
-    int controlHazard;
+    long long cycle;
+    long long instrCnt;
+    long long dataHazard;
+    long long loadUseHazard;
+    long long controlHazard;
     long long misPrediction;
     long long sucPrediction;
     clock_t stTime;
     clock_t edTime;
-    int ecallNum;
-    int FSTALL;
+    long long ecallNum;
+    long long FSTALL;
+    long long fetchAccess;    /*cache accesses made by Fetch*/
+    long long fetchBytes;     /*instruction bytes fetched*/
+    long long compressedCnt;  /*16-bit instructions fetched*/
+    long long straddleFetch;  /*instructions straddling a cache line*/
+    long long atomicCnt;      /*lr, sc and amo* performed*/
+    long long scFail;
+    long long vecInstr;       /*vector instructions performed*/
+    long long vecMemAccess;   /*cache line accesses by vector loads and stores*/
+    long long jalrCnt;
+    long long jalrPredicted;  /*jalr whose target Fetch got right*/
+    long long fetchBlocks;    /*FTQ entries read from the I-cache*/
+    long long ftqEmpty;       /*cycles Fetch found nothing to fetch*/
+    long long ftqFull;        /*cycles the predictor waited for room*/
+    long long fdipPrefetch;   /*lines prefetched ahead of Fetch*/
+    long long issueHist[MAX_ISSUE + 1];   /*cycles by instrs issued*/
+    long long groupDep;       /*groups cut short by a dependency inside the group*/
+    long long groupFu;        /*... by running out of units*/
 }stat;
 
 class Machine{
@@ -89,12 +161,23 @@ public:
 
     ~Machine();
     /*cpu environment*/
-    int64_t registers[REG_NUM];
+    int64_t registers[REG_NUM + FREG_NUM];  /*integer registers then raw fp registers*/
+    uint32_t fcsr;                          /*frm[7:5] fflags[4:0]*/
+
+    /*vector unit, vl and vtype are updated in order by Execute*/
+    int vlen;                               /*bits per vector register*/
+    uint64_t vecVl;
+    uint64_t vecVtype;
+    uint8_t vregs[VREG_NUM * VLEN_MAX / 8] __attribute__((aligned(16)));
+
+    /*lr/sc reservation, a physical cache line*/
+    uint64_t reservation;
+    bool reservationValid;
     uint64_t stackTop;
     uint64_t PC;
 
     /*some stats about machine*/
-    int machineCycle;
+    long long machineCycle;
     stat machineStats;
     int TicksPerCycle;
     int instrPfm[INSTRNUM]; /*instrucition performance*/
@@ -108,14 +191,50 @@ public:
     bool debug;
 
 
-    Predictor MyPred;               /*branch predictor*/
+    Predictor MyPred;               /*branch, BTB, RAS and indirect target predictor*/
+    BranchTraceWriter *brTrace;     /*resolved branches for bptool, NULL when off*/
+    IntervalSampler *intervals;     /*time series of the stats, NULL when off*/
+    Profiler *profiler;             /*per-PC hot spots, NULL when off*/
+    std::string profilePath;
+    std::string programPath;
+    ReuseAnalyzer *reuse;           /*reuse distances of the data accesses, NULL when off*/
+    std::string reusePath;
+    CacheSweep *sweep;              /*many L1D configs fed at once, NULL when off*/
+    std::string sweepPath;
+    int sweepThreads;
+    std::vector<std::pair<CacheConfig, bool> > sweepConfigs;  /*and whether to simulate it as a Cache*/
+
+    /*decoupled front end*/
+    int ftqEntries;
+    int fetchBlock;
+    bool fdip;                      /*fetch-directed instruction prefetch*/
+
+    /*in-order superscalar*/
+    int issueWidth;                 /*1, 2 or 4*/
+    int issueAlu;                   /*units per cycle*/
+    int issueMul;
+    int issueMem;
+
+    /*timing, fed by Writeback: the in-order scoreboard, or with --core ooo the out-of-order model*/
+    Scoreboard sboard;
+    bool oooModel;
+    OooCore ooo;
+    TimingModel *timing;            /*the one of them every cycle count comes from*/
+
+    /*everything Halt reports, dumped to statsFile when one is given*/
+    StatsRegistry stats;
+    std::string statsFile;
+    bool statsCsv;
 
     /*memory related*/
     Memory PhyMem;
     StorageLatency Memory_latency;
-    Cache L1;
-    CacheConfig L1_config;
-    StorageLatency L1_latency;
+    Cache L1I;                      /*instruction side, read by Fetch only*/
+    CacheConfig L1I_config;
+    StorageLatency L1I_latency;
+    Cache L1D;
+    CacheConfig L1D_config;
+    StorageLatency L1D_latency;
     Cache L2;
     CacheConfig L2_config;
     StorageLatency L2_latency;
@@ -132,9 +251,12 @@ public:
     bool ReadUserProg(const char *fileName);
     void PfmConfig(FILE *f);
 
-    /*reading byte(s) from main memory[addr] into val*/
-    void readBytes(uint64_t addr, int nbytes, void *val);
-    void writeBytes(uint64_t addr, int nbytes, void *val);
+    /*reading byte(s) from main memory[addr] into val, return access time*/
+    int readBytes(uint64_t addr, int nbytes, void *val);
+    int readInstr(uint64_t addr, int nbytes, void *val);    /*through L1I*/
+    int writeBytes(uint64_t addr, int nbytes, void *val);
+    /*vector access to a virtual range, split into cache lines*/
+    int vectorAccess(uint64_t virAddr, int nbytes, void *val, bool read);
 
     /*translate virtual address*/
     uint64_t translateAddr(uint64_t virAddr);
@@ -142,6 +264,10 @@ public:
     /*syscall*/
     void syscall();
 
+    /*control and status registers*/
+    int64_t readCSR(int csr);
+    void writeCSR(int csr, int64_t val);
+
     /*machine operations when starting and ending*/
     void StackAllocate();
     void Run();
@@ -149,6 +275,14 @@ public:
 
     /*select pred scheme*/
     void SetPredScheme(Scheme s);
+    bool SetBranchTrace(const char *path);
+    void SetCoreModel(bool outOfOrder);
+    void SetStatsFile(const char *path, bool csv);
+    bool SetIntervals(const char *path, uint64_t period, bool byCycles);
+    bool SetProfile(const char *path, const char *elfPath);
+    void SetReuse(const char *path, double rate, uint64_t window);
+    void SetSweep(const char *path, int threads);
+    void RegisterStats();
     void SetCacheConfig();
 
     void printSingleStep();
@@ -162,26 +296,56 @@ private:
 
     /*pipeline related*/
 private:
-    uint64_t predPC;
-    bool forwardA;   /*Was data forwarding already did by the former stage?*/
-    bool forwardB;
-
-    /*pipeline register*/
+    uint64_t predPC;                /*where the branch predictor continues*/
+    bool predStop;                  /*ran into an unmapped page, wait for a redirect*/
+    std::vector<FtqEntry> ftq;      /*ring of ftqEntries*/
+    int ftqHead;
+    int ftqCount;
+    int ftqSlot;                    /*next slot of the head entry*/
+    int fetchNum;                   /*slots Fetch handed out this cycle*/
+    int decodeNum;                  /*lanes Decode issued, the rest wait in DReg*/
+    int memTime;                    /*cache time of the current MemStage*/
+    int memMiss;                    /*and its L1D misses*/
+    int memLevel;                   /*deepest level they missed*/
+    int fetchMiss;                  /*L1I misses of the current fetch block*/
+    bool forwardA[MAX_ISSUE];   /*Was data forwarding already did by a younger instr?*/
+    bool forwardB[MAX_ISSUE];
+    bool forwardC[MAX_ISSUE];
+
+    /*pipeline register, one per lane, lane 0 holds the oldest instr*/
     PipReg FReg;
-    PipReg DReg;
-    PipReg DRegO;   /*output signal by fetch*/
-    PipReg EReg;
-    PipReg ERegO;
-    PipReg MReg;
-    PipReg MRegO;
-    PipReg WReg;
-    PipReg WRegO;
-
+    PipReg DReg[MAX_ISSUE];
+    PipReg DRegO[MAX_ISSUE];   /*output signal by fetch*/
+    PipReg EReg[MAX_ISSUE];
+    PipReg ERegO[MAX_ISSUE];
+    PipReg MReg[MAX_ISSUE];
+    PipReg MRegO[MAX_ISSUE];
+    PipReg WReg[MAX_ISSUE];
+    PipReg WRegO[MAX_ISSUE];
+
+    void PredictBlock();
     void Fetch();
+    void redirect(uint64_t pc);
+    void ftqAdvance(int n);
+    bool canIssue(int lane);
+    void forward(int64_t dst, int64_t val, const char *stage);
+    void flushYounger();
+    void latch();
+    void retireTiming(const PipReg &r);
+    void noteMiss(long long l2Misses, long long llcMisses);
+    void profileCall(const PipReg &r);
+    IntervalCounters intervalCounters();
+    bool peekInstr(uint64_t virAddr, uint32_t &ival, int &len);
     void Decode();
     void Execute();
     void MemStage();
     void Writeback();
+    void decodeLane(int l);
+    void executeLane(int l);
+    void memLane(int l);
+    void writebackLane(int l);
+
+    int64_t vectorExecute(const PipReg &r);
 
 };
 #endif
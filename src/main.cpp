@@ -4,6 +4,7 @@
 #include <cstring>
 #include <string>
 #include <iostream>
+#include <thread>
 #include "machine.h"
 
 using namespace std;
@@ -14,10 +15,22 @@ int main(int argc, char **argv){
     desc.add_options()
         ("help,h", "Print help message")
         ("singleStep,s", "Run in singleStep mode")    
-        ("predScheme,p", boost::program_options::value<string>(), "branch prediction scheme AT/ANT/BI/SA")
+        ("predScheme,p", boost::program_options::value<string>(), "branch prediction scheme AT/ANT/BI/SA/GS/TN/TAGE/PERC")
         ("file,f", boost::program_options::value<string>(), "user program to run")
         ("config,c", boost::program_options::value<string>(), "config file used for performance test")
         ("debug,d", "use debug mode")
+        ("trace,t", boost::program_options::value<string>(), "record a branch trace for bptool")
+        ("core", boost::program_options::value<string>(), "timing model inorder/ooo, sized by OOO_Config")
+        ("stats", boost::program_options::value<string>(), "dump stats and config to a file, CSV for *.csv else JSON")
+        ("stats-format", boost::program_options::value<string>(), "json or csv, overrides the file extension")
+        ("interval", boost::program_options::value<string>(), "sample stats every N instrs, or N cycles with a c suffix")
+        ("interval-file", boost::program_options::value<string>(), "interval series, binary for *.bin else CSV (intervals.csv)")
+        ("profile", boost::program_options::value<string>(), "per-PC profile to a file, stacks to file.folded, call graph to file.callgrind")
+        ("reuse", boost::program_options::value<string>(), "reuse distances, miss-ratio curve and working set of the data accesses to a file")
+        ("reuse-rate", boost::program_options::value<double>(), "fraction of cache lines sampled for --reuse (1)")
+        ("reuse-window", boost::program_options::value<unsigned long long>(), "accesses per working-set window (100000)")
+        ("sweep", boost::program_options::value<string>(), "miss rates of every Sweep_Config L1D to a CSV file")
+        ("sweep-threads", boost::program_options::value<int>(), "host threads for --sweep, default one per host cpu")
         ;
  
     boost::program_options::variables_map vm;
@@ -78,12 +91,24 @@ int main(int argc, char **argv){
         myMachine.SetPredScheme(Bimodal);
     else if(scmName.compare("SA") == 0)
         myMachine.SetPredScheme(SelfAdj);
+    else if(scmName.compare("GS") == 0)
+        myMachine.SetPredScheme(GShare);
+    else if(scmName.compare("TN") == 0)
+        myMachine.SetPredScheme(Tournament);
+    else if(scmName.compare("TAGE") == 0)
+        myMachine.SetPredScheme(Tage);
+    else if(scmName.compare("PERC") == 0)
+        myMachine.SetPredScheme(HashedPerc);
     else{
         printf("***Please choose a proper branch prediction scheme***\n");
         printf("AT    ------------Always Taken\n");
         printf("ANT   ------------Always Not Taken\n");
         printf("Bi    ------------Bimodal\n");
         printf("SA    ------------Self Adjustment\n");
+        printf("GS    ------------GShare\n");
+        printf("TN    ------------Tournament (local + global + chooser)\n");
+        printf("TAGE  ------------TAGE-SC-L\n");
+        printf("PERC  ------------Hashed Perceptron\n");
         printf("By default : Always Not Taken\n");
         printf("******************************************************\n");
     }
@@ -94,8 +119,71 @@ int main(int argc, char **argv){
         printf("DO NOT REMOVE default.cfg\n");
         return 0;
     }
+    myMachine.stats.Config("program", fileName);
+    myMachine.stats.Config("config_file", configName);
+    myMachine.stats.Config("pred_scheme", scmName.empty() ? "ANT" : scmName);
+    myMachine.stats.Config("core", "inorder");
     myMachine.PfmConfig(f);
 
+    if(vm.count("trace") && !myMachine.SetBranchTrace(vm["trace"].as<string>().c_str()))
+        return 0;
+
+    if(vm.count("core")){
+        string core = vm["core"].as<string>();
+        if(core.compare("ooo") == 0)
+            myMachine.SetCoreModel(true);
+        else if(core.compare("inorder") != 0){
+            printf("unknown core model %s, use inorder or ooo\n", core.c_str());
+            return 0;
+        }
+    }
+
+    if(vm.count("stats")){
+        string path = vm["stats"].as<string>();
+        bool csv = path.size() > 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        if(vm.count("stats-format")){
+            string fmt = vm["stats-format"].as<string>();
+            if(fmt.compare("csv") != 0 && fmt.compare("json") != 0){
+                printf("unknown stats format %s, use json or csv\n", fmt.c_str());
+                return 0;
+            }
+            csv = fmt.compare("csv") == 0;
+        }
+        myMachine.SetStatsFile(path.c_str(), csv);
+    }
+
+    if(vm.count("interval")){
+        string spec = vm["interval"].as<string>();
+        char *end;
+        unsigned long long period = strtoull(spec.c_str(), &end, 10);
+        bool byCycles = *end == 'c';
+        if(period == 0 || (*end != '\0' && !(byCycles && end[1] == '\0'))){
+            printf("bad interval %s, use N or Nc\n", spec.c_str());
+            return 0;
+        }
+        string path = vm.count("interval-file") ? vm["interval-file"].as<string>() : "intervals.csv";
+        if(!myMachine.SetIntervals(path.c_str(), period, byCycles))
+            return 0;
+    }
+
+    if(vm.count("profile"))
+        myMachine.SetProfile(vm["profile"].as<string>().c_str(), fileName.c_str());
+
+    if(vm.count("reuse")){
+        double rate = vm.count("reuse-rate") ? vm["reuse-rate"].as<double>() : 1.0;
+        unsigned long long window = vm.count("reuse-window") ? vm["reuse-window"].as<unsigned long long>() : 100000;
+        if(rate <= 0 || rate > 1 || window == 0){
+            printf("bad reuse sampling, rate in (0, 1] and window > 0\n");
+            return 0;
+        }
+        myMachine.SetReuse(vm["reuse"].as<string>().c_str(), rate, window);
+    }
+
+    if(vm.count("sweep")){
+        int threads = vm.count("sweep-threads") ? vm["sweep-threads"].as<int>() : (int)thread::hardware_concurrency();
+        myMachine.SetSweep(vm["sweep"].as<string>().c_str(), threads);
+    }
+
     myMachine.sgStep = singleStep;
     myMachine.debug = Debug;
     myMachine.ReadUserProg(fileName.c_str());
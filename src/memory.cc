@@ -11,8 +11,12 @@ void Memory::HandleRequest(uint64_t addr, int bytes, int read,
         ASSERT(false);
     hit = 1;
     time = latency_.hit_latency + latency_.bus_latency;
-    stats_.access_time += time;
-    stats_.access_counter ++;
+    if(prefetching_)
+        stats_.prefetch_num ++;
+    else{
+        stats_.access_time += time;
+        stats_.access_counter ++;
+    }
     //read bytes
     if(read){
         for(int i = 0; i < bytes; i++)
@@ -24,6 +28,12 @@ void Memory::HandleRequest(uint64_t addr, int bytes, int read,
     }
 }
 
+void Memory::Peek(uint64_t addr, int bytes, char *content) {
+    ASSERT(addr + bytes <= memSize);
+    for(int i = 0; i < bytes; i++)
+        content[i] = mainMem[addr + i];
+}
+
 Memory::Memory(int size){
     memSize = size;
     mainMem = new char[memSize];
@@ -12,6 +12,8 @@ class Memory: public Storage {
   // Main access process
   void HandleRequest(uint64_t addr, int bytes, int read,
                      char *content, int &hit, int &time);
+  // Functional read, no time and no stats
+  void Peek(uint64_t addr, int bytes, char *content);
 
  private:
   // Memory implement
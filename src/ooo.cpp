@@ -0,0 +1,333 @@
+#include "ooo.h"
+#include "utils.h"
+
+OooCore::OooCore(){
+    Init(OOO_WIDTH, OOO_ROB, OOO_IQ, OOO_LSQ, OOO_PREGS, false, OOO_WIDTH, 1, 2);
+}
+
+void
+OooCore::Init(int width, int rob, int iqs, int lsqs, int pregs, bool distributed,
+              int alu, int mul, int mem){
+    ASSERT(width > 0 && rob > 0 && iqs > 0 && lsqs > 0);
+    ASSERT(pregs > OOO_ARCH_REGS);
+    ASSERT(alu > 0 && mul > 0 && mem > 0);
+    this->width = width;
+    robSize = rob;
+    iqSize = iqs;
+    lsqSize = lsqs;
+    pregNum = pregs;
+    this->distributed = distributed;
+    units[FuAlu] = alu;
+    units[FuMul] = mul;
+    units[FuMem] = mem;
+
+    instrs = 0;
+    cycles = 0;
+    robFull = iqFull = lsqFull = regFull = 0;
+    frontFull = serialStall = 0;
+    forwards = mispredicts = squashed = 0;
+
+    fetchCycle = 0;
+    fetchCnt = 0;
+    lastTaken = false;
+    redirectAt = 0;
+    frontCap = width * OOO_FRONT + OOO_FETCH_BUF;
+    frontDispatch.assign(frontCap, 0);
+    lastDispatch = 0;
+    dispatchCnt = 0;
+    lastCommit = 0;
+    commitCnt = 0;
+    lastIssue = 0;
+
+    robCommit.assign(rob, 0);
+    for(int i = 0; i < FuClassNum; i++)
+        while(!iq[i].empty())
+            iq[i].pop();
+    SetUnits(fus);
+    lsq.clear();
+    stores.clear();
+
+    /*architectural state starts in the first physical registers*/
+    for(int i = 0; i < OOO_ARCH_REGS; i++)
+        renameMap[i] = i;
+    pregReady.assign(pregs, 0);
+    freeList.clear();
+    for(int i = pregs - 1; i >= OOO_ARCH_REGS; i--)
+        freeList.push_back(i);
+    pendingFree.clear();
+}
+
+/*the unit table, usually the scoreboard's, with the reservations cleared*/
+void
+OooCore::SetUnits(const std::vector<FuncUnit> &units){
+    fus = units;
+    unitTag.assign(fus.size(), std::vector<uint64_t>(OOO_WINDOW, (uint64_t)-1));
+    unitUsed.assign(fus.size(), std::vector<int>(OOO_WINDOW, 0));
+    for(size_t i = 0; i < fus.size(); i++){
+        fus[i].ops = 0;
+        fus[i].busy = 0;
+    }
+}
+
+/*units of kind k taken in cycle t*/
+int &
+OooCore::used(int k, uint64_t t){
+    int slot = t % OOO_WINDOW;
+    if(unitTag[k][slot] != t){
+        unitTag[k][slot] = t;
+        unitUsed[k][slot] = 0;
+    }
+    return unitUsed[k][slot];
+}
+
+/*first cycle from t on that a unit of kind k stays free for occupy cycles*/
+uint64_t
+OooCore::freeAt(int k, uint64_t t, int occupy){
+    for(;;){
+        int n = 0;
+        while(n < occupy && used(k, t + n) < fus[k].count)
+            n ++;
+        if(n == occupy)
+            return t;
+        t += n + 1;
+    }
+}
+
+void
+OooCore::Retire(const OooInstr &in){
+    /*
+        Fetch: width instrs per cycle, a taken branch ends the group and
+        an I-cache miss holds the block. After a misprediction nothing
+        useful arrives before the branch has completed, and nothing is
+        fetched while the front pipe and fetch buffer are full.
+    */
+    uint64_t f = fetchCycle;
+    if(fetchCnt == width || lastTaken){
+        f ++;
+        fetchCnt = 0;
+    }
+    if(f < redirectAt){
+        f = redirectAt;
+        fetchCnt = 0;
+    }
+    if(in.fetchLat > 1){
+        f += in.fetchLat - 1;
+        fetchCnt = 0;
+    }
+    if(instrs >= frontCap){
+        uint64_t t = frontDispatch[instrs % frontCap];
+        if(f < t){
+            frontFull += t - f;
+            f = t;
+            fetchCnt = 0;
+        }
+    }
+    fetchCycle = f;
+    fetchCnt ++;
+    lastTaken = in.taken;
+
+    /*dispatch in order, waiting for every structure it needs*/
+    uint64_t d = f + OOO_FRONT;
+    if(d < lastDispatch)
+        d = lastDispatch;
+    if(d == lastDispatch && dispatchCnt == width)
+        d ++;
+
+    /*ecall and csr accesses dispatch once everything older has committed*/
+    if(in.serialize && d < lastCommit){
+        serialStall += lastCommit - d;
+        d = lastCommit;
+    }
+
+    if(instrs >= robSize){
+        uint64_t t = robCommit[instrs % robSize];
+        if(d < t){
+            robFull += t - d;
+            d = t;
+        }
+    }
+
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > &q =
+        iq[distributed ? in.fu : 0];
+    while(!q.empty() && q.top() <= d)
+        q.pop();
+    if((int)q.size() >= iqSize){
+        uint64_t t = q.top();
+        iqFull += t - d;
+        d = t;
+        while(!q.empty() && q.top() <= d)
+            q.pop();
+    }
+
+    bool mem = in.load || in.store;
+    while(!lsq.empty() && lsq.front() <= d)
+        lsq.pop_front();
+    if(mem && (int)lsq.size() >= lsqSize){
+        uint64_t t = lsq.front();
+        lsqFull += t - d;
+        d = t;
+        while(!lsq.empty() && lsq.front() <= d)
+            lsq.pop_front();
+    }
+
+    /*registers come back when the instr that overwrote them commits*/
+    int need = (in.dst[0] != 0) + (in.dst[1] != 0);
+    while(!pendingFree.empty() && pendingFree.front().first <= d){
+        freeList.push_back(pendingFree.front().second);
+        pendingFree.pop_front();
+    }
+    while((int)freeList.size() < need){
+        ASSERT(!pendingFree.empty());
+        uint64_t t = pendingFree.front().first;
+        if(d < t){
+            regFull += t - d;
+            d = t;
+        }
+        freeList.push_back(pendingFree.front().second);
+        pendingFree.pop_front();
+    }
+
+    if(d != lastDispatch){
+        lastDispatch = d;
+        dispatchCnt = 0;
+    }
+    dispatchCnt ++;
+    frontDispatch[instrs % frontCap] = d;
+
+    /*rename: read sources through the map, then give dsts new registers*/
+    uint64_t ready = d + 1;
+    for(int i = 0; i < 3; i++)
+        if(in.src[i] != 0 && pregReady[renameMap[in.src[i]]] > ready)
+            ready = pregReady[renameMap[in.src[i]]];
+    int oldReg[2] = {-1, -1};
+    int newReg[2] = {-1, -1};
+    for(int i = 0; i < 2; i++){
+        if(in.dst[i] == 0)
+            continue;
+        oldReg[i] = renameMap[in.dst[i]];
+        newReg[i] = freeList.back();
+        freeList.pop_back();
+        renameMap[in.dst[i]] = newReg[i];
+    }
+
+    /*issue when the operands are ready and a unit of the op's kind is free long enough*/
+    int k = -1, exec = 1, occupy = 1;
+    uint64_t is = 0;
+    for(size_t i = 0; i < fus.size(); i++){
+        if(!(fus[i].classes & (1u << in.op)))
+            continue;
+        int e = fus[i].latency;
+        if(e == 0)
+            e = mem ? in.memLat : in.lat;
+        if(e < 1)
+            e = 1;
+        int o = fus[i].ii > 0 ? fus[i].ii : e;
+        ASSERT(o < OOO_WINDOW);
+        uint64_t t = freeAt(i, ready, o);
+        if(k < 0 || t < is){
+            k = i;
+            is = t;
+            exec = e;
+            occupy = o;
+        }
+    }
+    ASSERT(k >= 0);
+    for(int n = 0; n < occupy; n++)
+        used(k, is + n) ++;
+    fus[k].ops ++;
+    fus[k].busy += occupy;
+    lastIssue = is;
+    q.push(is);
+
+    /*
+        A load looks for the youngest older store still in flight that
+        touches its bytes. Full cover forwards the store data, a partial
+        overlap has to wait until the store has written the cache.
+    */
+    uint64_t done;
+    if(in.load){
+        int lat = exec;
+        done = is + lat;
+        if(in.size > 0)
+            for(std::deque<OooStore>::reverse_iterator s = stores.rbegin(); s != stores.rend(); ++s){
+                if(s->commit <= is)
+                    continue;
+                if(s->addr >= in.addr + in.size || in.addr >= s->addr + s->size)
+                    continue;
+                if(s->addr <= in.addr && in.addr + in.size <= s->addr + s->size){
+                    done = (s->dataReady > is ? s->dataReady : is) + 1;
+                    forwards ++;
+                }
+                else
+                    done = s->commit + lat;
+                break;
+            }
+    }
+    else if(in.store)
+        done = is + 1;  /*address and data into the LSQ, the cache is written at commit*/
+    else
+        done = is + exec;
+
+    for(int i = 0; i < 2; i++)
+        if(newReg[i] >= 0)
+            pregReady[newReg[i]] = done;
+
+    /*commit in order, width per cycle*/
+    uint64_t c = done + 1;
+    if(c < lastCommit)
+        c = lastCommit;
+    if(c == lastCommit && commitCnt == width)
+        c ++;
+    if(c != lastCommit){
+        lastCommit = c;
+        commitCnt = 0;
+    }
+    commitCnt ++;
+    cycles = c;
+    /*younger instrs are fetched again once a serializing one commits*/
+    if(in.serialize && redirectAt < c)
+        redirectAt = c;
+
+    robCommit[instrs % robSize] = c;
+    if(mem)
+        lsq.push_back(c);
+    for(int i = 0; i < 2; i++)
+        if(oldReg[i] >= 0)
+            pendingFree.push_back(std::make_pair(c, oldReg[i]));
+    if(in.store && in.size > 0){
+        OooStore s;
+        s.addr = in.addr;
+        s.size = in.size;
+        s.dataReady = done;
+        s.commit = c;
+        stores.push_back(s);
+    }
+    while(!stores.empty() && stores.front().commit <= d)
+        stores.pop_front();
+
+    /*wrong path fetched until the branch completes, bounded by the ROB*/
+    if(in.mispredict){
+        mispredicts ++;
+        redirectAt = done + 1;
+        uint64_t wrong = (done + 1 - f) * width;
+        squashed += wrong < (uint64_t)robSize ? wrong : robSize;
+    }
+    instrs ++;
+}
+
+void
+OooCore::RegisterStats(StatsRegistry &r, const std::string &prefix){
+    r.Formula(prefix + ".cycles", [this](){ return (double)cycles; });
+    r.Counter(prefix + ".instrs", &instrs);
+    r.Formula(prefix + ".ipc", [this](){ return cycles > 0 ? (double)instrs / cycles : 0.0; });
+    r.Counter(prefix + ".stall.rob", &robFull, "dispatch cycles lost to a full ROB");
+    r.Counter(prefix + ".stall.iq", &iqFull);
+    r.Counter(prefix + ".stall.lsq", &lsqFull);
+    r.Counter(prefix + ".stall.regs", &regFull);
+    r.Counter(prefix + ".stall.front", &frontFull, "fetch cycles lost to a full fetch buffer");
+    r.Counter(prefix + ".stall.serialize", &serialStall);
+    r.Counter(prefix + ".forwards", &forwards, "loads served by an older store");
+    r.Counter(prefix + ".mispredicts", &mispredicts);
+    r.Counter(prefix + ".squashed", &squashed);
+    RegisterUnits(r, prefix);
+}
@@ -0,0 +1,112 @@
+#ifndef OOO_H
+#define OOO_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <string>
+#include "stats.h"
+#include "timing.h"
+
+#define OOO_WIDTH 4             //default fetch / dispatch / commit width
+#define OOO_ROB 128
+#define OOO_IQ 48               //per queue when distributed
+#define OOO_LSQ 48
+#define OOO_PREGS 192           //physical registers, int and fp together
+#define OOO_FRONT 5             //cycles from fetch to dispatch
+#define OOO_FETCH_BUF 16        //instrs fetched ahead of dispatch besides the front pipe
+#define OOO_ARCH_REGS 64        //x0-x31 then f0-f31
+#define OOO_WINDOW 4096         //cycles tracked by the unit reservation table
+
+/*issue queues when they are kept per class, and the default unit counts*/
+enum FuClass{
+    FuAlu, FuMul, FuMem, FuClassNum
+};
+
+typedef struct OooStore{
+    uint64_t addr;
+    int size;
+    uint64_t dataReady;
+    uint64_t commit;
+}OooStore;
+
+/*
+ *Out-of-order timing model. The in-order pipeline still executes every
+ *instruction, so results, predictions and cache contents are its own;
+ *each committed instruction is then replayed here through fetch,
+ *rename, dispatch into the ROB / issue queue / LSQ, issue on a free
+ *unit, completion and in-order commit, and the cycles are those of the
+ *out-of-order core. A misprediction redirects fetch only once the
+ *branch completes, everything fetched meanwhile is counted as squashed.
+ *Units are the FU table the in-order scoreboard uses, each held for its
+ *initiation interval or, with ii 0, the whole latency.
+ */
+class OooCore: public TimingModel{
+public:
+    OooCore();
+    void Init(int width, int rob, int iqs, int lsqs, int pregs, bool distributed,
+              int alu, int mul, int mem);
+    void SetUnits(const std::vector<FuncUnit> &units);
+    void Retire(const OooInstr &in);
+    uint64_t Cycles(){ return cycles; }
+    uint64_t LastIssue(){ return lastIssue; }
+    void RegisterStats(StatsRegistry &r, const std::string &prefix);
+
+    int width;
+    int robSize;
+    int iqSize;
+    int lsqSize;
+    int pregNum;
+    bool distributed;   /*one issue queue per unit class*/
+    int units[FuClassNum];  /*alu / mul / mem counts of the default FU table*/
+
+    /*stats*/
+    uint64_t cycles;    /*last commit*/
+    long long robFull;  /*dispatch cycles lost to each full structure*/
+    long long iqFull;
+    long long lsqFull;
+    long long regFull;
+    long long frontFull;    /*fetch cycles lost to a full fetch buffer*/
+    long long serialStall;  /*dispatch cycles an ecall / csr waited for older instrs to commit*/
+    long long forwards; /*loads served by an older in-flight store*/
+    long long mispredicts;
+    long long squashed;
+
+private:
+    int &used(int k, uint64_t t);
+    uint64_t freeAt(int k, uint64_t t, int occupy);
+
+    /*fetch*/
+    uint64_t fetchCycle;
+    int fetchCnt;
+    bool lastTaken;
+    uint64_t redirectAt;
+    int frontCap;                       /*instrs between fetch and dispatch*/
+    std::vector<uint64_t> frontDispatch;    /*ring, dispatch time by instr number*/
+
+    /*dispatch and commit, in order*/
+    uint64_t lastDispatch;
+    int dispatchCnt;
+    uint64_t lastCommit;
+    int commitCnt;
+    uint64_t lastIssue;
+
+    std::vector<uint64_t> robCommit;    /*ring, commit time by instr number*/
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > iq[FuClassNum];
+    std::deque<uint64_t> lsq;           /*commit times of memory ops in flight*/
+    std::deque<OooStore> stores;
+
+    /*rename*/
+    int renameMap[OOO_ARCH_REGS];
+    std::vector<uint64_t> pregReady;
+    std::vector<int> freeList;
+    std::deque<std::pair<uint64_t, int> > pendingFree;  /*(commit, preg) released in order*/
+
+    /*reservation table, units of each FuncUnit taken per cycle*/
+    std::vector<std::vector<uint64_t> > unitTag;
+    std::vector<std::vector<int> > unitUsed;
+};
+
+#endif
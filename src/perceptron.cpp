@@ -0,0 +1,108 @@
+#include "perceptron.h"
+#include "utils.h"
+#include <string.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+Perceptron::Perceptron(){
+    Init(PERC_ROW_BITS, PERC_HIST);
+}
+
+void
+Perceptron::Init(int rows, int hist){
+    ASSERT(rows > 0 && rows <= 16);
+    ASSERT(hist > 0 && hist <= PERC_MAX_HIST);
+    rowBits = rows;
+    histLen = (hist + 15) & ~15;
+    theta = (int)(1.93 * histLen + 14);
+
+    weights.assign((size_t)histLen << rowBits, 0);
+    bias.assign(1 << rowBits, 0);
+    /*an empty history reads as not taken*/
+    memset(this->hist, -1, sizeof(this->hist));
+    head = 0;
+}
+
+/*sum of w[i] * x[i] with x[i] = +1 / -1*/
+static int
+dotSign(const int8_t *w, const int8_t *x, int n){
+    int sum = 0;
+    int i = 0;
+#if defined(__SSSE3__)
+    __m128i acc = _mm_setzero_si128();
+    const __m128i ones8 = _mm_set1_epi8(1);
+    const __m128i ones16 = _mm_set1_epi16(1);
+    for(; i + 16 <= n; i += 16){
+        __m128i prod = _mm_sign_epi8(_mm_loadu_si128((const __m128i *)(w + i)),
+                                     _mm_loadu_si128((const __m128i *)(x + i)));
+        /*int8 -> pairwise int16 -> pairwise int32*/
+        __m128i pairs = _mm_maddubs_epi16(ones8, prod);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, ones16));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+    sum = _mm_cvtsi128_si32(acc);
+#endif
+    for(; i < n; i++)
+        sum += w[i] * x[i];
+    return sum;
+}
+
+/*w[i] += x[i] (or -= when not taken), saturating at +-127*/
+static void
+trainSign(int8_t *w, const int8_t *x, int n, bool taken){
+    int i = 0;
+#if defined(__SSE4_1__)
+    const __m128i lo = _mm_set1_epi8(-127);
+    for(; i + 16 <= n; i += 16){
+        __m128i wv = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i xv = _mm_loadu_si128((const __m128i *)(x + i));
+        wv = taken ? _mm_adds_epi8(wv, xv) : _mm_subs_epi8(wv, xv);
+        _mm_storeu_si128((__m128i *)(w + i), _mm_max_epi8(wv, lo));
+    }
+#endif
+    for(; i < n; i++){
+        int v = w[i] + (taken ? x[i] : -x[i]);
+        if(v > 127)
+            v = 127;
+        if(v < -127)
+            v = -127;
+        w[i] = (int8_t)v;
+    }
+}
+
+bool
+Perceptron::Predict(int64_t addr, PercMeta &meta){
+    uint32_t pc = (uint32_t)(addr >> 1);
+    meta.row = (pc ^ (pc >> rowBits)) & ((1u << rowBits) - 1);
+    meta.head = head;
+    meta.sum = bias[meta.row] +
+               dotSign(&weights[(size_t)meta.row * histLen], window(head), histLen);
+    push(meta.sum >= 0);
+    return meta.sum >= 0;
+}
+
+void
+Perceptron::update(bool taken, const PercMeta &meta){
+    bool pred = meta.sum >= 0;
+    int mag = meta.sum >= 0 ? meta.sum : -meta.sum;
+
+    if(pred != taken || mag <= theta){
+        int8_t &b = bias[meta.row];
+        if(taken && b < 127)
+            b ++;
+        else if(!taken && b > -127)
+            b --;
+        trainSign(&weights[(size_t)meta.row * histLen], window(meta.head), histLen, taken);
+    }
+
+    if(pred != taken){
+        head = meta.head;
+        push(taken);
+    }
+}
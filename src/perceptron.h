@@ -0,0 +1,58 @@
+#ifndef PERCEPTRON_H
+#define PERCEPTRON_H
+
+#include <stdint.h>
+#include <vector>
+
+#define PERC_ROW_BITS 9         //default log2 of weight rows
+#define PERC_HIST 64            //default global history length
+#define PERC_MAX_HIST 512
+#define PERC_RING 1024          //history ring, leaves room for branches in flight
+
+typedef struct PercMeta{
+    uint32_t row;
+    uint32_t head;      /*history position before this branch was pushed*/
+    int32_t sum;
+}PercMeta;
+
+/*
+ *Perceptron predictor. The weight row is picked by hashing the pc and
+ *dotted with the last histLen outcomes (+1 taken, -1 not taken).
+ *Weights are int8 and a row is contiguous, so the dot product and the
+ *training step run 16 weights at a time with SSE.
+ *The predicted direction is pushed speculatively, a misprediction
+ *rewinds the ring to the branch and pushes the outcome.
+ */
+class Perceptron{
+public:
+    Perceptron();
+    void Init(int rowBits, int hist);
+    bool Predict(int64_t addr, PercMeta &meta);
+    void update(bool taken, const PercMeta &meta);
+    uint32_t Checkpoint(){
+        return head;
+    }
+    void Restore(uint32_t h){
+        head = h;
+    }
+
+    int rowBits;
+    int histLen;        /*multiple of 16*/
+    int theta;          /*training threshold*/
+
+private:
+    inline const int8_t *window(uint32_t head){
+        return &hist[head + PERC_RING - histLen + 1];
+    }
+    inline void push(bool taken){
+        head = (head + 1) % PERC_RING;
+        hist[head] = hist[head + PERC_RING] = taken ? 1 : -1;
+    }
+
+    std::vector<int8_t> weights;    /*2^rowBits rows of histLen*/
+    std::vector<int8_t> bias;
+    int8_t hist[2 * PERC_RING];     /*every outcome is stored twice so any window is contiguous*/
+    uint32_t head;
+};
+
+#endif
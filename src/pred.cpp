@@ -17,6 +17,34 @@ inline int maskHis(int his){
     return his & ((1 << HISTORYN) - 1);
 }
 
+/*saturating 2-bit counter moved toward taken / not taken*/
+inline void twoBitUpdate(char &tb, bool taken){
+    if(taken && tb < 3)
+        tb ++;
+    else if(!taken && tb > 0)
+        tb --;
+}
+
+inline uint64_t maskBits(uint64_t val, int bits){
+    return val & ((1ull << bits) - 1);
+}
+
+void
+Predictor::RegisterStats(StatsRegistry &r, const std::string &prefix){
+    r.Counter(prefix + ".branch_btb.lookups", &btbBrLookup, "conditional branches resolved");
+    r.Counter(prefix + ".branch_btb.hits", &btbBrHit);
+    r.Counter(prefix + ".btb.lookups", &targets.btbLookup);
+    r.Counter(prefix + ".btb.hits", &targets.btbHit);
+    r.Counter(prefix + ".btb.correct", &targets.btbCorrect);
+    r.Counter(prefix + ".ras.pops", &targets.rasPop);
+    r.Counter(prefix + ".ras.correct", &targets.rasCorrect);
+    r.Counter(prefix + ".ras.overflows", &targets.rasOverflow);
+    r.Counter(prefix + ".ras.underflows", &targets.rasUnderflow);
+    r.Counter(prefix + ".ittage.lookups", &targets.ittLookup);
+    r.Counter(prefix + ".ittage.hits", &targets.ittHit);
+    r.Counter(prefix + ".ittage.correct", &targets.ittCorrect);
+}
+
 Predictor::Predictor(){
     predScm = AlwaysTaken;
     for(int i = 0; i < BUFNUM; i++)
@@ -26,6 +54,42 @@ Predictor::Predictor(){
         for(int j = 0; j < (1 << HISTORYN); j++)
             saBuf[i][j] = 0;
     }
+
+    globalHis = 0;
+    btbBrLookup = btbBrHit = 0;
+    SetGShare(GSHARE_BITS);
+    SetTournament(TOUR_LOCAL_BITS, TOUR_LOCALHIS_BITS, TOUR_GLOBAL_BITS);
+}
+
+void
+Predictor::SetGShare(int hisBits){
+    ASSERT(hisBits > 0 && hisBits <= 24);
+    gsBits = hisBits;
+    gsTable.assign(1 << hisBits, 1);     /*weakly not taken*/
+}
+
+void
+Predictor::SetTage(int budgetKB, int tables){
+    tage.Init(budgetKB, tables);
+}
+
+void
+Predictor::SetPerceptron(int rowBits, int histLen){
+    perc.Init(rowBits, histLen);
+}
+
+void
+Predictor::SetTournament(int localBits, int localHisBits, int globalBits){
+    ASSERT(localBits > 0 && localBits <= 24);
+    ASSERT(localHisBits > 0 && localHisBits <= 24);
+    ASSERT(globalBits > 0 && globalBits <= 24);
+    tnLocalBits = localBits;
+    tnLocalHisBits = localHisBits;
+    tnGlobalBits = globalBits;
+    tnLocalHis.assign(1 << localBits, 0);
+    tnLocalTable.assign(1 << localHisBits, 1);
+    tnGlobalTable.assign(1 << globalBits, 1);
+    tnChooser.assign(1 << globalBits, 1);  /*weakly local*/
 }
 
 void
@@ -34,109 +98,166 @@ Predictor::SetScheme(Scheme scm){
 }
 
 bool
-Predictor::Predict(int64_t addr){
-    int bufID = (addr >> 2) % BUFNUM;
+Predictor::direction(int64_t pc, PredMeta &meta){
+    int bufID = (pc >> 2) % BUFNUM;
     ASSERT((bufID >= 0 && bufID < 256));
     if(predScm == AlwaysTaken)
         return true;
     if(predScm == AlwaysNotTaken)
         return false;
 
-    if(predScm == Bimodal){
+    if(predScm == Bimodal)
         return twoBitChoose(bitBuf[bufID]);
-    }
 
     if(predScm == SelfAdj){
-        for(int i = 0; i < (1 << HISTORYN); i++)
-            if(maskHis(saHis[bufID]) == i){
-                return twoBitChoose(saBuf[bufID][i]);
-            }
+        meta.local = maskHis(saHis[bufID]);
+        return twoBitChoose(saBuf[bufID][meta.local]);
     }
+
+    if(predScm == GShare)
+        return twoBitChoose(gsTable[maskBits((pc >> 2) ^ globalHis, gsBits)]);
+
+    if(predScm == Tournament){
+        uint64_t g = maskBits(globalHis, tnGlobalBits);
+        meta.local = tnLocalHis[maskBits(pc >> 2, tnLocalBits)];
+        if(twoBitChoose(tnChooser[g]))
+            return twoBitChoose(tnGlobalTable[g]);
+        return twoBitChoose(tnLocalTable[meta.local]);
+    }
+
+    if(predScm == Tage)
+        return tage.Predict(pc, meta.tage);
+    if(predScm == HashedPerc)
+        return perc.Predict(pc, meta.perc);
     return false;
 }
 
+Prediction
+Predictor::predict(int64_t pc, int kind, int rd, int rs1, int64_t retAddr){
+    Prediction p;
+    p.meta.kind = kind;
+    p.meta.global = globalHis;
+    p.meta.local = 0;
+    if(kind == BrJal){
+        /*the target is computed in Fetch*/
+        targets.FetchJal(rd, retAddr);
+        p.taken = true;
+        p.hasTarget = p.meta.pred = false;
+        return p;
+    }
+    if(kind == BrJalr){
+        p.taken = true;
+        p.hasTarget = p.meta.pred = targets.FetchJalr(pc, rd, rs1, retAddr, p.meta.target, p.target);
+        p.meta.predTarget = p.target;
+        return p;
+    }
+
+    p.taken = p.meta.pred = direction(pc, p.meta);
+    p.hasTarget = p.meta.btbHit = targets.BtbLookup(pc, p.target);
+
+    /*speculative global history, tage and perceptron keep their own*/
+    if(predScm == GShare)
+        globalHis = maskBits((globalHis << 1) | p.taken, gsBits);
+    if(predScm == Tournament)
+        globalHis = maskBits((globalHis << 1) | p.taken, tnGlobalBits);
+    return p;
+}
+
+PredCkpt
+Predictor::Checkpoint(){
+    PredCkpt cp;
+    cp.global = globalHis;
+    if(predScm == Tage)
+        cp.tage = tage.Checkpoint();
+    if(predScm == HashedPerc)
+        cp.percHead = perc.Checkpoint();
+    cp.ras = targets.Checkpoint();
+    return cp;
+}
+
+void
+Predictor::Repair(const PredCkpt &cp){
+    globalHis = cp.global;
+    if(predScm == Tage)
+        tage.Restore(cp.tage);
+    if(predScm == HashedPerc)
+        perc.Restore(cp.percHead);
+    targets.Repair(cp.ras);
+}
+
 void
-Predictor::update(bool success, int64_t addr){
+Predictor::update(int64_t pc, bool taken, int64_t target, const PredMeta &meta){
+    if(meta.kind == BrJalr){
+        targets.update(pc, target, meta.pred, meta.predTarget, meta.target);
+        return;
+    }
+    if(meta.kind != BrCond)
+        return;
 
-    int bufID = (addr >> 2) % BUFNUM;
+    /*directions feed the indirect target history too*/
+    targets.Outcome(taken);
+    btbBrLookup ++;
+    if(meta.btbHit)
+        btbBrHit ++;
+    if(taken)
+        targets.BtbInsert(pc, target);
+    updateDirection(pc, taken, meta);
+}
 
+void
+Predictor::updateDirection(int64_t pc, bool taken, const PredMeta &meta){
+    int bufID = (pc >> 2) % BUFNUM;
     ASSERT((bufID >= 0 && bufID < 256));
+
     if(predScm == AlwaysTaken)
         return ;
     if(predScm == AlwaysNotTaken)
         return ;
 
     if(predScm == Bimodal){
-        switch(bitBuf[bufID]){
-            case 0:
-                if(success)
-                    bitBuf[bufID] = 0;
-                else
-                    bitBuf[bufID] = 1;
-                break;
-            case 1:
-                if(success)
-                    bitBuf[bufID] = 0;
-                else
-                    bitBuf[bufID] = 2;
-                break;
-            case 2:
-                if(success)
-                    bitBuf[bufID] = 3;
-                else 
-                    bitBuf[bufID] = 1;
-                break;
-            case 3:
-                if(success)
-                    bitBuf[bufID] = 3;
-                else
-                    bitBuf[bufID] = 2;
-                break;
-        }
+        twoBitUpdate(bitBuf[bufID], taken);
         return;
     }
 
     if(predScm == SelfAdj){
-        int lastHisMode = 0;
-        for(int i = 0; i < (1 << HISTORYN); i++)
-            if(maskHis(saHis[bufID]) == i){
-                lastHisMode = i;
-                break;
-            }
-
-        int lastJump = 0;
-        bool lastPred = twoBitChoose(saBuf[bufID][lastHisMode]);
-        lastJump = (!success) ^ lastPred;
-
-        lastJump &= 0x1;
-        saHis[bufID] = (maskHis(saHis[bufID]) << 1) | lastJump;
-
-        switch(saBuf[bufID][lastHisMode]){
-            case 0:
-                if(success)
-                    saBuf[bufID][lastHisMode] = 0;
-                else
-                    saBuf[bufID][lastHisMode] = 1;
-                break;
-            case 1:
-                if(success)
-                    saBuf[bufID][lastHisMode] = 0;
-                else
-                    saBuf[bufID][lastHisMode] = 2;
-                break;
-            case 2:
-                if(success)
-                    saBuf[bufID][lastHisMode] = 3;
-                else 
-                    saBuf[bufID][lastHisMode] = 1;
-                break;
-            case 3:
-                if(success)
-                    saBuf[bufID][lastHisMode] = 3;
-                else
-                    saBuf[bufID][lastHisMode] = 2;
-                break;
-        }
+        twoBitUpdate(saBuf[bufID][meta.local], taken);
+        saHis[bufID] = maskHis((saHis[bufID] << 1) | taken);
+        return;
+    }
+
+    if(predScm == GShare){
+        twoBitUpdate(gsTable[maskBits((pc >> 2) ^ meta.global, gsBits)], taken);
+        if(meta.pred != taken)
+            globalHis = maskBits((meta.global << 1) | taken, gsBits);
+        return;
+    }
+
+    if(predScm == Tournament){
+        uint64_t g = maskBits(meta.global, tnGlobalBits);
+        uint64_t l = maskBits(pc >> 2, tnLocalBits);
+        uint32_t lh = meta.local;
+        bool localPred = twoBitChoose(tnLocalTable[lh]);
+        bool globalPred = twoBitChoose(tnGlobalTable[g]);
+
+        /*the chooser only learns when the two components disagree*/
+        if(localPred != globalPred)
+            twoBitUpdate(tnChooser[g], globalPred == taken);
+        twoBitUpdate(tnLocalTable[lh], taken);
+        twoBitUpdate(tnGlobalTable[g], taken);
+
+        tnLocalHis[l] = maskBits((tnLocalHis[l] << 1) | taken, tnLocalHisBits);
+        if(meta.pred != taken)
+            globalHis = maskBits((meta.global << 1) | taken, tnGlobalBits);
+        return;
+    }
+
+    if(predScm == Tage){
+        tage.update(pc, taken, meta.tage);
+        return;
+    }
+
+    if(predScm == HashedPerc){
+        perc.update(taken, meta.perc);
         return;
     }
 }
@@ -2,22 +2,86 @@
 #define PRED_H
 
 #include <stdint.h>
+#include <vector>
 #include "utils.h"
+#include "tage.h"
+#include "perceptron.h"
+#include "target.h"
+#include "brtrace.h"
+#include "stats.h"
 
 #define BUFNUM 16
 #define HISTORYN 4  //num of bits to save history status
                     // should not be more than 32 (sizeof(int))
 
+#define GSHARE_BITS 12         //default log2 of gshare counters (= history bits)
+#define TOUR_LOCAL_BITS 10     //default log2 of tournament local history entries
+#define TOUR_LOCALHIS_BITS 10  //default local history length
+#define TOUR_GLOBAL_BITS 12    //default global history length
+
 enum Scheme{
-    AlwaysTaken, AlwaysNotTaken, Bimodal, SelfAdj
+    AlwaysTaken, AlwaysNotTaken, Bimodal, SelfAdj, GShare, Tournament, Tage, HashedPerc
 };
 
+/*
+ *Everything a scheme needs to train the entries it used for one
+ *prediction. It travels down the pipeline with the branch and comes
+ *back in update(), older branches may have trained the tables since.
+ */
+typedef struct PredMeta{
+    int kind;           /*BranchKind*/
+    bool pred;          /*predicted direction, for jalr whether a target was*/
+    uint64_t global;    /*global history before this branch was pushed*/
+    uint32_t local;     /*local history used for the prediction*/
+    bool btbHit;
+    TageMeta tage;
+    PercMeta perc;
+    int64_t predTarget; /*jalr target from the RAS, ITTAGE or BTB*/
+    TargetMeta target;
+}PredMeta;
+
+typedef struct Prediction{
+    bool taken;
+    bool hasTarget;     /*target came from the BTB, RAS or ITTAGE*/
+    int64_t target;
+    PredMeta meta;
+}Prediction;
+
+/*
+ *Speculative front-end state. Fetch takes one before each instruction
+ *and one after it, a redirect or a refetch rolls back to them.
+ */
+typedef struct PredCkpt{
+    uint64_t global;
+    TageHist tage;
+    uint32_t percHead;
+    RasCheckpoint ras;
+}PredCkpt;
+
+/*
+ *Branch predictor. predict() pushes the predicted direction into the
+ *global history straight away, update() trains with the real outcome
+ *and repairs the history when the prediction was wrong. Local histories
+ *are only written in update(). jal and jalr go through the same two
+ *calls with their link registers, a jal only drives the RAS and has no
+ *update(), a jalr is predicted by the RAS or the target predictor.
+ */
 class Predictor{
 public:
     Predictor();
-    bool Predict(int64_t addr);
-    void update(bool success, int64_t addr);
+    Prediction predict(int64_t pc, int kind = BrCond, int rd = 0, int rs1 = 0,
+                       int64_t retAddr = 0);
+    void update(int64_t pc, bool taken, int64_t target, const PredMeta &meta);
+    PredCkpt Checkpoint();
+    void Repair(const PredCkpt &cp);
+    void RegisterStats(StatsRegistry &r, const std::string &prefix);
+
     void SetScheme(Scheme scm);
+    /*table sizes are given in bits (log2 of entries)*/
+    void SetGShare(int hisBits);
+    void SetTournament(int localBits, int localHisBits, int globalBits);
+    void SetTage(int budgetKB, int tables);
+    void SetPerceptron(int rowBits, int histLen);
 
     /*member variable*/
     Scheme predScm;
@@ -25,6 +89,30 @@ public:
 
     char saBuf[BUFNUM][1  << HISTORYN];
     int saHis[BUFNUM];
+
+    uint64_t globalHis;     /*shared by gshare and tournament*/
+
+    int gsBits;
+    std::vector<char> gsTable;
+
+    int tnLocalBits;
+    int tnLocalHisBits;
+    int tnGlobalBits;
+    std::vector<uint32_t> tnLocalHis;   /*per-branch history*/
+    std::vector<char> tnLocalTable;     /*indexed by local history*/
+    std::vector<char> tnGlobalTable;    /*indexed by global history*/
+    std::vector<char> tnChooser;        /*>= 2 picks global*/
+
+    TageSCL tage;
+    Perceptron perc;
+
+    TargetPred targets;     /*BTB, return address stack and indirect targets*/
+    long long btbBrLookup;  /*conditional branches resolved*/
+    long long btbBrHit;     /*... whose target the BTB held*/
+
+private:
+    bool direction(int64_t pc, PredMeta &meta);
+    void updateDirection(int64_t pc, bool taken, const PredMeta &meta);
 };
 
 #endif
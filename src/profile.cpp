@@ -0,0 +1,444 @@
+#include "profile.h"
+#include "utils.h"
+#include <elfio/elfio.hpp>
+#include <algorithm>
+#include <string.h>
+
+static const char *eventNames[PfFieldNum] = {
+    "Cycles", "Instrs", "L1iMiss", "L1dMiss", "Mispred", "LoadUse"
+};
+
+Profiler::Profiler(){
+    table = NULL;
+    pcs = 0;
+    lastIssue = 0;
+    lastPc = PROF_EMPTY;
+    memset(total, 0, sizeof(total));
+    funcs.resize(1);
+    memset(&funcs[0], 0, sizeof(ProfFunc));
+    resize(PROF_INIT_SIZE);
+}
+
+Profiler::~Profiler(){
+    delete[] table;
+}
+
+/*rehash everything into a table of the given size*/
+void
+Profiler::resize(uint64_t slots){
+    ProfEntry *old = table;
+    uint64_t oldSlots = old != NULL ? mask + 1 : 0;
+
+    table = new ProfEntry[slots];
+    for(uint64_t i = 0; i < slots; i++)
+        table[i].pc = PROF_EMPTY;
+    mask = slots - 1;
+    shift = 64;
+    while(slots > 1){
+        slots >>= 1;
+        shift --;
+    }
+
+    for(uint64_t i = 0; i < oldSlots; i++){
+        if(old[i].pc == PROF_EMPTY)
+            continue;
+        uint64_t k = hash(old[i].pc);
+        while(table[k].pc != PROF_EMPTY)
+            k = (k + 1) & mask;
+        table[k] = old[i];
+    }
+    delete[] old;
+}
+
+/*first sight of a PC, the table is kept at most half full*/
+ProfEntry *
+Profiler::insert(uint64_t pc, uint64_t slot){
+    if(2 * (pcs + 1) > mask + 1){
+        resize(2 * (mask + 1));
+        slot = hash(pc);
+        while(table[slot].pc != PROF_EMPTY)
+            slot = (slot + 1) & mask;
+    }
+    ProfEntry &e = table[slot];
+    e.pc = pc;
+    e.func = funcOf(pc);
+    e.edge = -1;
+    memset(e.v, 0, sizeof(e.v));
+    pcs ++;
+    return &e;
+}
+
+static bool
+symbolLess(const ProfSymbol &a, const ProfSymbol &b){
+    return a.addr < b.addr || (a.addr == b.addr && a.size > b.size);
+}
+
+/*functions, and the labels of hand-written code, of executable sections*/
+bool
+Profiler::LoadSymbols(const char *elfPath){
+    ELFIO::elfio reader;
+    if(!reader.load(elfPath))
+        return false;
+
+    syms.clear();
+    for(int i = 0; i < reader.sections.size(); i++){
+        ELFIO::section *sec = reader.sections[i];
+        if(sec->get_type() != SHT_SYMTAB)
+            continue;
+        ELFIO::symbol_section_accessor symbols(reader, sec);
+        for(ELFIO::Elf_Xword k = 0; k < symbols.get_symbols_num(); k++){
+            ProfSymbol s;
+            ELFIO::Elf_Half shndx;
+            unsigned char bind, type, other;
+            if(!symbols.get_symbol(k, s.name, s.addr, s.size, bind, type, shndx, other))
+                continue;
+            if(s.name.empty() || (type != STT_FUNC && type != STT_NOTYPE))
+                continue;
+            if(shndx == SHN_UNDEF || shndx >= reader.sections.size() ||
+                    !(reader.sections[shndx]->get_flags() & SHF_EXECINSTR))
+                continue;
+            /*assembler locals like .L0 only clutter the profile*/
+            if(s.name.compare(0, 2, ".L") == 0)
+                continue;
+            syms.push_back(s);
+        }
+    }
+    /*of the names at one address keep the sized one, a function over its label*/
+    std::sort(syms.begin(), syms.end(), symbolLess);
+    size_t n = 0;
+    for(size_t i = 0; i < syms.size(); i++)
+        if(n == 0 || syms[n - 1].addr != syms[i].addr)
+            syms[n ++] = syms[i];
+    syms.resize(n);
+
+    funcs.resize(syms.size() + 1);
+    memset(&funcs[0], 0, funcs.size() * sizeof(ProfFunc));
+    return !syms.empty();
+}
+
+/*the symbol covering pc, NULL when there is none*/
+const ProfSymbol *
+Profiler::Symbolize(uint64_t pc){
+    size_t lo = 0, hi = syms.size();
+    while(lo < hi){
+        size_t mid = (lo + hi) / 2;
+        if(syms[mid].addr <= pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo == 0)
+        return NULL;
+    const ProfSymbol *s = &syms[lo - 1];
+    if(s->size > 0 && pc >= s->addr + s->size)
+        return NULL;
+    return s;
+}
+
+int
+Profiler::funcOf(uint64_t pc){
+    const ProfSymbol *s = Symbolize(pc);
+    return s != NULL ? s - &syms[0] : syms.size();
+}
+
+const char *
+Profiler::funcName(int func){
+    return func < (int)syms.size() ? syms[func].name.c_str() : "[unknown]";
+}
+
+/*push a frame for func, the first one is the entry function*/
+void
+Profiler::enter(int func){
+    ProfFrame f;
+    f.func = func;
+    f.edge = -1;
+    f.ret = PROF_EMPTY;
+    f.node = stack.empty() ? -1 : stack.back().node;
+    memcpy(f.entry, total, sizeof(total));
+
+    /*direct recursion stays in its caller's context*/
+    if(stack.empty() || stack.back().func != func){
+        std::pair<int, int> key(f.node, func);
+        std::map<std::pair<int, int>, int>::iterator it = children.find(key);
+        if(it == children.end()){
+            ProfNode n;
+            n.func = func;
+            n.parent = f.node;
+            n.cycles = 0;
+            nodes.push_back(n);
+            it = children.insert(std::make_pair(key, (int)nodes.size() - 1)).first;
+        }
+        f.node = it->second;
+    }
+    funcs[func].active ++;
+    stack.push_back(f);
+}
+
+/*pop the top frame, only the outermost activation adds to inclusive costs*/
+void
+Profiler::leave(){
+    const ProfFrame &f = stack.back();
+    uint64_t d[PfFieldNum];
+    for(int k = 0; k < PfFieldNum; k++)
+        d[k] = total[k] - f.entry[k];
+
+    ProfFunc &fn = funcs[f.func];
+    if(-- fn.active == 0)
+        for(int k = 0; k < PfFieldNum; k++)
+            fn.incl[k] += d[k];
+    if(f.edge >= 0){
+        ProfEdge &e = edges[f.edge];
+        if(-- e.active == 0)
+            for(int k = 0; k < PfFieldNum; k++)
+                e.incl[k] += d[k];
+    }
+    stack.pop_back();
+}
+
+/*a retired jal or jalr that links, pc already charged to the caller*/
+void
+Profiler::Call(uint64_t pc, uint64_t target, uint64_t ret){
+    int callee = lookup(target)->func;
+    ProfEntry *site = lookup(pc);       /*after, a new target may grow the table*/
+    int caller = stack.back().func;
+
+    int e = site->edge;
+    if(e < 0 || edges[e].callee != callee){
+        std::pair<uint64_t, int> key(pc, callee);
+        std::map<std::pair<uint64_t, int>, int>::iterator it = edgeIndex.find(key);
+        if(it == edgeIndex.end()){
+            ProfEdge n;
+            n.site = pc;
+            n.target = target;
+            n.caller = caller;
+            n.callee = callee;
+            n.calls = 0;
+            n.active = 0;
+            memset(n.incl, 0, sizeof(n.incl));
+            edges.push_back(n);
+            it = edgeIndex.insert(std::make_pair(key, (int)edges.size() - 1)).first;
+        }
+        e = it->second;
+        site->edge = e;
+    }
+
+    enter(callee);
+    ProfFrame &f = stack.back();
+    f.edge = e;
+    f.ret = ret;
+    funcs[callee].calls ++;
+    edges[e].calls ++;
+    edges[e].active ++;
+}
+
+/*
+    A return pops up to the frame it goes back to. longjmp and the like
+    may skip a few, a return matching none of the recent frames leaves
+    the stack as it is.
+*/
+void
+Profiler::Return(uint64_t target){
+    for(size_t d = 1; d <= PROF_RET_SEARCH && d < stack.size(); d++)
+        if(stack[stack.size() - d].ret == target){
+            while(d-- > 0)
+                leave();
+            return;
+        }
+}
+
+static bool
+cyclesMore(const ProfEntry *a, const ProfEntry *b){
+    return a->v[PfCycles] > b->v[PfCycles] ||
+        (a->v[PfCycles] == b->v[PfCycles] && a->pc < b->pc);
+}
+
+static bool
+pcLess(const ProfEntry *a, const ProfEntry *b){
+    return a->pc < b->pc;
+}
+
+static double
+percent(uint64_t a, uint64_t b){
+    return b > 0 ? 100.0 * a / b : 0.0;
+}
+
+static void
+putRow(FILE *f, const uint64_t *v, uint64_t cycles){
+    fprintf(f, "%7.2f %12llu %12llu %6.2f %9llu %9llu %9llu %9llu  ",
+            percent(v[PfCycles], cycles),
+            (unsigned long long)v[PfCycles], (unsigned long long)v[PfInstrs],
+            v[PfInstrs] > 0 ? (double)v[PfCycles] / v[PfInstrs] : 0.0,
+            (unsigned long long)v[PfIMiss], (unsigned long long)v[PfDMiss],
+            (unsigned long long)v[PfMispred], (unsigned long long)v[PfLoadUse]);
+}
+
+static const char *rowHead =
+    "%cycles       cycles       instrs    CPI  l1i_miss  l1d_miss   mispred  load_use  ";
+
+/*functions by self cycles, with their inclusive cycles and calls, then the hottest PCs*/
+void
+Profiler::writeFlat(FILE *f, uint64_t cycles){
+    std::vector<ProfEntry *> hot;
+    /*self costs per function, pc holding its index*/
+    std::vector<ProfEntry> self(funcs.size());
+    for(size_t i = 0; i < self.size(); i++){
+        self[i].pc = i;
+        memset(self[i].v, 0, sizeof(self[i].v));
+    }
+    for(uint64_t i = 0; i <= mask; i++){
+        if(table[i].pc == PROF_EMPTY)
+            continue;
+        hot.push_back(&table[i]);
+        for(int k = 0; k < PfFieldNum; k++)
+            self[table[i].func].v[k] += table[i].v[k];
+    }
+
+    std::vector<ProfEntry *> order;
+    for(size_t i = 0; i < self.size(); i++)
+        if(self[i].v[PfInstrs] > 0 || funcs[i].incl[PfInstrs] > 0)
+            order.push_back(&self[i]);
+    std::sort(order.begin(), order.end(), cyclesMore);
+    std::sort(hot.begin(), hot.end(), cyclesMore);
+
+    fprintf(f, "Flat profile: %llu cycles, %llu PCs\n\n",
+            (unsigned long long)cycles, (unsigned long long)pcs);
+    fprintf(f, "%s %%incl  incl_cycles      calls  function\n", rowHead);
+    for(size_t i = 0; i < order.size(); i++){
+        const ProfFunc &fn = funcs[order[i]->pc];
+        putRow(f, order[i]->v, cycles);
+        fprintf(f, "%6.2f %12llu %10llu  %s\n", percent(fn.incl[PfCycles], cycles),
+                (unsigned long long)fn.incl[PfCycles], (unsigned long long)fn.calls,
+                funcName(order[i]->pc));
+    }
+
+    fprintf(f, "\nHot PCs:\n%spc\n", rowHead);
+    for(size_t i = 0; i < hot.size() && i < PROF_HOT_PCS; i++){
+        putRow(f, hot[i]->v, cycles);
+        const ProfSymbol *s = Symbolize(hot[i]->pc);
+        if(s != NULL)
+            fprintf(f, "0x%llx %s+0x%llx\n", (unsigned long long)hot[i]->pc,
+                    s->name.c_str(), (unsigned long long)(hot[i]->pc - s->addr));
+        else
+            fprintf(f, "0x%llx\n", (unsigned long long)hot[i]->pc);
+    }
+}
+
+/*caller;...;callee cycles, one line per calling context, for flamegraph.pl and friends*/
+void
+Profiler::writeFolded(FILE *f){
+    std::vector<int> path;
+    for(size_t i = 0; i < nodes.size(); i++){
+        if(nodes[i].cycles == 0)
+            continue;
+        path.clear();
+        for(int n = i; n >= 0; n = nodes[n].parent)
+            path.push_back(nodes[n].func);
+        for(size_t k = path.size(); k > 0; k--)
+            fprintf(f, k > 1 ? "%s;" : "%s", funcName(path[k - 1]));
+        fprintf(f, " %llu\n", (unsigned long long)nodes[i].cycles);
+    }
+}
+
+static void
+putCosts(FILE *f, const uint64_t *v){
+    for(int k = 0; k < PfFieldNum; k++)
+        fprintf(f, " %llu", (unsigned long long)v[k]);
+    fputc('\n', f);
+}
+
+/*
+    Callgrind format with instruction addresses as positions: per
+    function its PCs' self costs, then for each call site the callee and
+    the inclusive cost of the calls.
+*/
+void
+Profiler::writeCallgrind(FILE *f, const char *program){
+    fprintf(f, "# callgrind format\nversion: 1\ncreator: riscvsim\ncmd: %s\n", program);
+    fprintf(f, "positions: instr\nevents:");
+    for(int k = 0; k < PfFieldNum; k++)
+        fprintf(f, " %s", eventNames[k]);
+    fprintf(f, "\nsummary:");
+    putCosts(f, total);
+    fprintf(f, "\nob=%s\n", program);
+
+    std::vector<std::vector<ProfEntry *> > pcsOf(funcs.size());
+    std::vector<std::vector<int> > callsOf(funcs.size());
+    for(uint64_t i = 0; i <= mask; i++)
+        if(table[i].pc != PROF_EMPTY)
+            pcsOf[table[i].func].push_back(&table[i]);
+    for(size_t i = 0; i < edges.size(); i++)
+        callsOf[edges[i].caller].push_back(i);
+
+    /*names are given once, later (id) alone*/
+    std::vector<bool> named(funcs.size(), false);
+    for(size_t fn = 0; fn < funcs.size(); fn++){
+        if(pcsOf[fn].empty() && callsOf[fn].empty())
+            continue;
+        fprintf(f, "\nfn=(%d)", (int)fn + 1);
+        if(!named[fn])
+            fprintf(f, " %s", funcName(fn));
+        fputc('\n', f);
+        named[fn] = true;
+
+        std::sort(pcsOf[fn].begin(), pcsOf[fn].end(), pcLess);
+        for(size_t i = 0; i < pcsOf[fn].size(); i++){
+            fprintf(f, "0x%llx", (unsigned long long)pcsOf[fn][i]->pc);
+            putCosts(f, pcsOf[fn][i]->v);
+        }
+        for(size_t i = 0; i < callsOf[fn].size(); i++){
+            const ProfEdge &e = edges[callsOf[fn][i]];
+            fprintf(f, "cfn=(%d)", e.callee + 1);
+            if(!named[e.callee])
+                fprintf(f, " %s", funcName(e.callee));
+            named[e.callee] = true;
+            fprintf(f, "\ncalls=%llu 0x%llx\n0x%llx", (unsigned long long)e.calls,
+                    (unsigned long long)e.target, (unsigned long long)e.site);
+            putCosts(f, e.incl);
+        }
+    }
+}
+
+/*
+    path gets the flat profile, path.folded the stacks and
+    path.callgrind the call graph. The cycles after the last issue,
+    draining the pipeline, go to the last PC so the profile adds up to
+    the run, then the frames still on the stack are closed.
+*/
+bool
+Profiler::Write(const char *path, const char *program, uint64_t cycles){
+    if(lastPc != PROF_EMPTY && cycles > lastIssue){
+        lookup(lastPc)->v[PfCycles] += cycles - lastIssue;
+        total[PfCycles] += cycles - lastIssue;
+        nodes[stack.back().node].cycles += cycles - lastIssue;
+        lastIssue = cycles;
+    }
+    while(!stack.empty())
+        leave();
+
+    FILE *f = fopen(path, "w");
+    if(f == NULL){
+        printf("Fail to create profile %s!\n", path);
+        return false;
+    }
+    writeFlat(f, cycles);
+    fclose(f);
+
+    std::string name = std::string(path) + ".folded";
+    f = fopen(name.c_str(), "w");
+    if(f == NULL){
+        printf("Fail to create profile %s!\n", name.c_str());
+        return false;
+    }
+    writeFolded(f);
+    fclose(f);
+
+    name = std::string(path) + ".callgrind";
+    f = fopen(name.c_str(), "w");
+    if(f == NULL){
+        printf("Fail to create profile %s!\n", name.c_str());
+        return false;
+    }
+    writeCallgrind(f, program);
+    fclose(f);
+    return true;
+}
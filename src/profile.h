@@ -0,0 +1,155 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#define PROF_INIT_SIZE 4096     //slots, a power of 2
+#define PROF_EMPTY (~(uint64_t)0)
+#define PROF_HOT_PCS 50         //PCs listed in the flat profile
+#define PROF_RET_SEARCH 8       //frames a return may unwind to find its caller
+
+/*what is charged to a PC*/
+enum ProfField{
+    PfCycles, PfInstrs, PfIMiss, PfDMiss, PfMispred, PfLoadUse, PfFieldNum
+};
+
+typedef struct ProfEntry{
+    uint64_t pc;                /*PROF_EMPTY for a free slot*/
+    int func;                   /*symbol of pc*/
+    int edge;                   /*last call made from pc, -1 before one*/
+    uint64_t v[PfFieldNum];
+}ProfEntry;
+
+typedef struct ProfSymbol{
+    uint64_t addr;
+    uint64_t size;              /*0 for a label, it runs to the next symbol*/
+    std::string name;
+}ProfSymbol;
+
+/*a call site and the function it calls*/
+typedef struct ProfEdge{
+    uint64_t site;
+    uint64_t target;            /*of the first call*/
+    int caller;
+    int callee;
+    uint64_t calls;
+    int active;                 /*frames of this edge on the stack*/
+    uint64_t incl[PfFieldNum];
+}ProfEdge;
+
+typedef struct ProfFunc{
+    uint64_t calls;
+    int active;
+    uint64_t incl[PfFieldNum];
+}ProfFunc;
+
+/*a node of the calling context tree, what the folded stacks are made of*/
+typedef struct ProfNode{
+    int func;
+    int parent;
+    uint64_t cycles;
+}ProfNode;
+
+typedef struct ProfFrame{
+    int func;
+    int node;
+    int edge;                   /*-1 for the entry function*/
+    uint64_t ret;               /*where its return lands*/
+    uint64_t entry[PfFieldNum]; /*totals when it was called*/
+}ProfFrame;
+
+/*
+ *Per-PC hot spots. Each retired instruction is charged the issue cycles
+ *since the one before it, so the cycles of a PC are the time the core
+ *waited on it, and the L1 misses, mispredictions and load-use stalls it
+ *caused. PCs live in an open-addressing table with linear probing, one
+ *multiply and usually one probe per instruction, each symbolized once
+ *when first seen.
+ *
+ *Calls and returns, as the link register hints of jal and jalr give
+ *them, keep a shadow call stack. A function's inclusive cost is taken
+ *between its outermost call and return only, and so is a call edge's,
+ *so recursion is not counted once per level and costs O(1) per call.
+ *Direct recursion shares one calling context, the folded stacks stay
+ *as deep as the distinct callers.
+ */
+class Profiler{
+public:
+    Profiler();
+    ~Profiler();
+    bool LoadSymbols(const char *elfPath);
+    bool Write(const char *path, const char *program, uint64_t cycles);
+    const ProfSymbol *Symbolize(uint64_t pc);
+
+    void Retire(uint64_t pc, uint64_t issue, int imiss, int dmiss, bool mispredict){
+        ProfEntry *e = lookup(pc);
+        uint64_t cycles = issue - lastIssue;
+        if(stack.empty())
+            enter(e->func);
+        e->v[PfInstrs] ++;
+        e->v[PfCycles] += cycles;
+        e->v[PfIMiss] += imiss;
+        e->v[PfDMiss] += dmiss;
+        e->v[PfMispred] += mispredict;
+        total[PfInstrs] ++;
+        total[PfCycles] += cycles;
+        total[PfIMiss] += imiss;
+        total[PfDMiss] += dmiss;
+        total[PfMispred] += mispredict;
+        nodes[stack.back().node].cycles += cycles;
+        lastIssue = issue;
+        lastPc = pc;
+    }
+    void LoadUse(uint64_t pc){
+        lookup(pc)->v[PfLoadUse] ++;
+        total[PfLoadUse] ++;
+    }
+    void Call(uint64_t pc, uint64_t target, uint64_t ret);
+    void Return(uint64_t target);
+
+    uint64_t pcs;               /*distinct PCs seen*/
+
+private:
+    ProfEntry *lookup(uint64_t pc){
+        uint64_t i = hash(pc);
+        while(table[i].pc != pc){
+            if(table[i].pc == PROF_EMPTY)
+                return insert(pc, i);
+            i = (i + 1) & mask;
+        }
+        return &table[i];
+    }
+    uint64_t hash(uint64_t pc){
+        return ((pc >> 1) * 0x9e3779b97f4a7c15ULL) >> shift;
+    }
+    ProfEntry *insert(uint64_t pc, uint64_t slot);
+    void resize(uint64_t slots);
+    int funcOf(uint64_t pc);
+    const char *funcName(int func);
+    void enter(int func);
+    void leave();
+    void writeFlat(FILE *f, uint64_t cycles);
+    void writeFolded(FILE *f);
+    void writeCallgrind(FILE *f, const char *program);
+
+    ProfEntry *table;
+    uint64_t mask;
+    int shift;
+    uint64_t lastIssue;
+    uint64_t lastPc;
+    uint64_t total[PfFieldNum];
+
+    std::vector<ProfSymbol> syms;   /*sorted by addr*/
+    std::vector<ProfFunc> funcs;    /*per symbol, the last for PCs without one*/
+    std::vector<ProfEdge> edges;
+    std::map<std::pair<uint64_t, int>, int> edgeIndex;
+    std::vector<ProfNode> nodes;
+    std::map<std::pair<int, int>, int> children;   /*(parent, func) to node*/
+    std::vector<ProfFrame> stack;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "reuse.h"
+#include "utils.h"
+#include <algorithm>
+#include <string.h>
+
+ReuseAnalyzer::ReuseAnalyzer(int lineBits, double rate, uint64_t window){
+    ASSERT(rate > 0 && rate <= 1 && window > 0);
+    this->lineBits = lineBits;
+    this->rate = rate;
+    this->window = window;
+    threshold = (uint64_t)(rate * (1 << REUSE_HASH_BITS));
+    if(threshold == 0)
+        threshold = 1;
+
+    tree.assign(REUSE_INIT_SLOTS + 1, 0);
+    next = 1;
+    marks = 0;
+    accesses = 0;
+    samples = 0;
+    cold = 0;
+    memset(hist, 0, sizeof(hist));
+    windowNum = 0;
+    windowLines = 0;
+}
+
+void
+ReuseAnalyzer::mark(uint64_t pos, int d){
+    for(; pos < tree.size(); pos += pos & -pos)
+        tree[pos] += d;
+}
+
+/*marks at positions above pos*/
+uint64_t
+ReuseAnalyzer::marksAfter(uint64_t pos){
+    uint64_t upTo = 0;
+    for(; pos > 0; pos -= pos & -pos)
+        upTo += tree[pos];
+    return marks - upTo;
+}
+
+/*
+    Renumber the marked positions 1..lines in order, the distances only
+    depend on their order. The tree doubles once the lines take more
+    than half of it.
+*/
+void
+ReuseAnalyzer::compact(){
+    std::vector<std::pair<uint64_t, ReuseLine *> > order;
+    order.reserve(lines.size());
+    for(std::unordered_map<uint64_t, ReuseLine>::iterator it = lines.begin(); it != lines.end(); ++it)
+        order.push_back(std::make_pair(it->second.pos, &it->second));
+    std::sort(order.begin(), order.end());
+
+    size_t slots = tree.size() - 1;
+    while(2 * order.size() > slots)
+        slots *= 2;
+    tree.assign(slots + 1, 0);
+    for(size_t i = 0; i < order.size(); i++){
+        order[i].second->pos = i + 1;
+        mark(i + 1, 1);
+    }
+    next = order.size() + 1;
+}
+
+void
+ReuseAnalyzer::closeWindow(){
+    workingSet.push_back(windowLines);
+    windowLines = 0;
+    windowNum ++;
+}
+
+void
+ReuseAnalyzer::sampled(uint64_t line){
+    while(accesses > (windowNum + 1) * window)
+        closeWindow();
+    if(next == tree.size())
+        compact();
+    samples ++;
+
+    std::pair<std::unordered_map<uint64_t, ReuseLine>::iterator, bool> r =
+        lines.insert(std::make_pair(line, ReuseLine()));
+    ReuseLine &l = r.first->second;
+    if(r.second){
+        cold ++;
+        l.window = 0;
+    }
+    else{
+        /*distinct sampled lines since, scaled to all lines*/
+        uint64_t d = (uint64_t)(marksAfter(l.pos) / rate);
+        int b = 0;
+        while(d > 0 && b < REUSE_BINS - 1){
+            d >>= 1;
+            b ++;
+        }
+        hist[b] ++;
+        mark(l.pos, -1);
+        marks --;
+    }
+    l.pos = next ++;
+    mark(l.pos, 1);
+    marks ++;
+
+    if(l.window != windowNum + 1){
+        l.window = windowNum + 1;
+        windowLines ++;
+    }
+}
+
+/*
+    Summary, distance histogram, miss ratio per LRU capacity and the
+    working set per window, counts scaled back by the sampling rate.
+*/
+bool
+ReuseAnalyzer::Write(const char *path){
+    FILE *f = fopen(path, "w");
+    if(f == NULL){
+        printf("Fail to create reuse report %s!\n", path);
+        return false;
+    }
+    int lineSize = 1 << lineBits;
+    fprintf(f, "Reuse distance: %llu accesses, %d-byte lines, sampling rate %g\n",
+            (unsigned long long)accesses, lineSize, rate);
+    fprintf(f, "sampled accesses %llu, distinct lines %.0f (%.0f bytes)\n\n",
+            (unsigned long long)samples, lines.size() / rate, lines.size() / rate * lineSize);
+
+    fprintf(f, "distance_lines,accesses,cumulative\n");
+    double total = samples > 0 ? samples : 1;
+    uint64_t sum = 0;
+    for(int b = 0; b < REUSE_BINS; b++){
+        if(hist[b] == 0)
+            continue;
+        sum += hist[b];
+        if(b == 0)
+            fprintf(f, "0,");
+        else
+            fprintf(f, "%llu-%llu,", 1ULL << (b - 1), (1ULL << b) - 1);
+        fprintf(f, "%.0f,%.6f\n", hist[b] / rate, sum / total);
+    }
+    fprintf(f, "cold,%.0f,1.000000\n\n", cold / rate);
+
+    /*a capacity of 2^k lines hits every distance below it*/
+    fprintf(f, "capacity_bytes,miss_ratio\n");
+    uint64_t hits = 0;
+    for(int k = 0; k < REUSE_BINS; k++){
+        hits += hist[k];
+        fprintf(f, "%llu,%.6f\n", (unsigned long long)lineSize << k, 1.0 - hits / total);
+        if(hits + cold == samples)
+            break;
+    }
+
+    fprintf(f, "\nwindow_end_access,working_set_lines,working_set_bytes\n");
+    for(size_t i = 0; i < workingSet.size(); i++)
+        fprintf(f, "%llu,%.0f,%.0f\n", (unsigned long long)((i + 1) * window),
+                workingSet[i] / rate, workingSet[i] / rate * lineSize);
+    if(windowLines > 0)
+        fprintf(f, "%llu,%.0f,%.0f\n", (unsigned long long)accesses,
+                windowLines / rate, windowLines / rate * lineSize);
+    fclose(f);
+    return true;
+}
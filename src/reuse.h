@@ -0,0 +1,75 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <unordered_map>
+
+#define REUSE_BINS 48           //log2 distance bins, bin 0 is distance 0
+#define REUSE_INIT_SLOTS (1 << 16)
+#define REUSE_HASH_BITS 24      //sampling resolution
+
+typedef struct ReuseLine{
+    uint64_t pos;               /*sampled access that touched it last, its mark in the tree*/
+    uint64_t window;            /*last working-set window it was counted in, +1*/
+}ReuseLine;
+
+/*
+ *Reuse (LRU stack) distances of the data accesses at cache line
+ *granularity, Olken's way: the line's last access is marked in a
+ *Fenwick tree over access positions and the distance is the marks
+ *after it, O(log n) per access. The positions are renumbered when the
+ *tree is full, so it stays at a few times the lines in use.
+ *
+ *Only lines whose hash falls under the rate are followed and their
+ *distances scaled by 1/rate (spatial sampling as in SHARDS), which
+ *keeps the distribution while cutting the work and memory by the rate.
+ *A histogram of the distances gives the miss ratio of every
+ *fully-associative LRU cache of the line size in one pass.
+ *
+ *The working set is the distinct lines touched per window of accesses,
+ *of the sampled lines too.
+ */
+class ReuseAnalyzer{
+public:
+    ReuseAnalyzer(int lineBits, double rate, uint64_t window);
+    bool Write(const char *path);
+
+    void Access(uint64_t addr){
+        accesses ++;
+        uint64_t line = addr >> lineBits;
+        if(((line * 0x9e3779b97f4a7c15ULL) >> (64 - REUSE_HASH_BITS)) >= threshold)
+            return;
+        sampled(line);
+    }
+
+    uint64_t accesses;          /*all of them, sampled or not*/
+
+private:
+    void sampled(uint64_t line);
+    void mark(uint64_t pos, int d);
+    uint64_t marksAfter(uint64_t pos);
+    void compact();
+    void closeWindow();
+
+    int lineBits;
+    double rate;
+    uint64_t threshold;
+
+    std::unordered_map<uint64_t, ReuseLine> lines;
+    std::vector<int> tree;      /*Fenwick tree, 1-based*/
+    uint64_t next;              /*next position*/
+    uint64_t marks;
+
+    uint64_t samples;
+    uint64_t cold;              /*first touches*/
+    uint64_t hist[REUSE_BINS];  /*bin b > 0 holds distances [2^(b-1), 2^b)*/
+
+    uint64_t window;            /*accesses per working-set window*/
+    uint64_t windowNum;
+    uint64_t windowLines;
+    std::vector<uint64_t> workingSet;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "machine.h"
 #include "utils.h"
+#include "fpu.h"
 
 #define T_OPCODE 1            /*fetch different parts in an instruction in maskInstr()*/
 #define T_RD 2
@@ -18,12 +19,28 @@
 enum instrName{
     Iadd, Imul, Isub, Isll, Imulh,Islt, Ixor, Idiv, Isrl, Isra,Ior, Irem, Iand, Ilb, Ilh,Ilw, Ild, Iaddi, Islli, Islti,
     Ixori, Isrli, Israi, Iori, Iandi,Iaddiw, Ijalr, Iecall, Isb, Ish,Isw, Isd, Ibeq, Ibne, Iblt,Ibge, Iauipc, Ilui, Ijal, Ibltu,
-    Ibgeu, Ilbu, Ilhu, Ilwu, Isltiu,Isltu, Islliw, Isrliw, Israiw, Iaddw,Isubw, Isllw, Isrlw, Israw, Inop
+    Ibgeu, Ilbu, Ilhu, Ilwu, Isltiu,Isltu, Islliw, Isrliw, Israiw, Iaddw,Isubw, Isllw, Isrlw, Israw, Inop,
+    Imulhsu, Imulhu, Idivu, Iremu, Imulw, Idivw, Idivuw, Iremw, Iremuw,
+    Iflw, Ifld, Ifsw, Ifsd,
+    IfmaddS, IfmaddD, IfmsubS, IfmsubD, IfnmsubS, IfnmsubD, IfnmaddS, IfnmaddD,
+    IfaddS, IfaddD, IfsubS, IfsubD, IfmulS, IfmulD, IfdivS, IfdivD, IfsqrtS, IfsqrtD,
+    IfsgnjS, IfsgnjD, IfsgnjnS, IfsgnjnD, IfsgnjxS, IfsgnjxD, IfminS, IfminD, IfmaxS, IfmaxD,
+    IfcvtSD, IfcvtDS, IfeqS, IfeqD, IfltS, IfltD, IfleS, IfleD,
+    IfcvtWS, IfcvtWD, IfcvtWUS, IfcvtWUD, IfcvtLS, IfcvtLD, IfcvtLUS, IfcvtLUD,
+    IfcvtSW, IfcvtDW, IfcvtSWU, IfcvtDWU, IfcvtSL, IfcvtDL, IfcvtSLU, IfcvtDLU,
+    IfmvXW, IfmvXD, IfclassS, IfclassD, IfmvWX, IfmvDX,
+    Icsrrw, Icsrrs, Icsrrc, Icsrrwi, Icsrrsi, Icsrrci,
+    IlrW, IlrD, IscW, IscD, IamoswapW, IamoswapD, IamoaddW, IamoaddD, IamoxorW, IamoxorD,
+    IamoandW, IamoandD, IamoorW, IamoorD, IamominW, IamominD, IamomaxW, IamomaxD, IamominuW, IamominuD,
+    IamomaxuW, IamomaxuD, Ifence, IfenceI,
+    IvsetVli, IvsetIvli, IvsetVl, Ivle, Ivse, Ivlse, Ivsse,
+    IvaddVV, IvaddVX, IvaddVI, IvsubVV, IvsubVX, IvmulVV, IvmulVX, IvmaccVV, IvmaccVX,
+    IvredsumVS, IvmvVV, IvmvVX, IvmvVI, IvmvXS
 };
 
 
 enum instrType{
-    R_type, I_type, S_type, SB_type, U_type, UJ_type
+    R_type, I_type, S_type, SB_type, U_type, UJ_type, R4_type
 };
     
 int64_t sig64ext(int len, uint32_t val){
@@ -111,68 +128,515 @@ int64_t maskInstr(int type, uint32_t ival){
     return ires;
 }
 
+/*32-bit instruction encoders used to expand compressed instructions*/
+static uint32_t encR(uint32_t op, uint32_t rd, uint32_t f3, uint32_t rs1, uint32_t rs2, uint32_t f7){
+    return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op;
+}
+
+static uint32_t encI(uint32_t op, uint32_t rd, uint32_t f3, uint32_t rs1, int32_t imm){
+    return ((uint32_t)(imm & 0xfff) << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op;
+}
+
+static uint32_t encS(uint32_t op, uint32_t f3, uint32_t rs1, uint32_t rs2, int32_t imm){
+    uint32_t u = (uint32_t)imm;
+    return (((u >> 5) & 0x7f) << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) |
+           ((u & 0x1f) << 7) | op;
+}
+
+static uint32_t encB(uint32_t f3, uint32_t rs1, uint32_t rs2, int32_t imm){
+    uint32_t u = (uint32_t)imm;
+    return (((u >> 12) & 0x1) << 31) | (((u >> 5) & 0x3f) << 25) | (rs2 << 20) |
+           (rs1 << 15) | (f3 << 12) | (((u >> 1) & 0xf) << 8) | (((u >> 11) & 0x1) << 7) | 0x63;
+}
+
+static uint32_t encJ(uint32_t rd, int32_t imm){
+    uint32_t u = (uint32_t)imm;
+    return (((u >> 20) & 0x1) << 31) | (((u >> 1) & 0x3ff) << 21) | (((u >> 11) & 0x1) << 20) |
+           (((u >> 12) & 0xff) << 12) | (rd << 7) | 0x6f;
+}
+
+/*bits [hi:lo] of a compressed instruction*/
+static inline uint32_t cbits(uint32_t c, int hi, int lo){
+    return (c >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+/*sign extend the low n bits*/
+static inline int32_t csext(uint32_t v, int n){
+    return (int32_t)(v << (32 - n)) >> (32 - n);
+}
+
+/*
+    Expand a 16-bit RV64C instruction into its 32-bit equivalent.
+    Reserved encodings and the all-zero illegal instruction become 0,
+    which Decode treats as nop just like an all-zero 32-bit word.
+*/
+uint32_t expandCompressed(uint16_t ci){
+    uint32_t c = ci;
+    uint32_t funct3 = cbits(c, 15, 13);
+    uint32_t rdp = cbits(c, 4, 2) + 8;      /*rd' / rs2'*/
+    uint32_t rs1p = cbits(c, 9, 7) + 8;     /*rs1' / rd'*/
+    uint32_t rd = cbits(c, 11, 7);
+    uint32_t rs2 = cbits(c, 6, 2);
+    int32_t imm6 = csext((cbits(c, 12, 12) << 5) | cbits(c, 6, 2), 6);
+    uint32_t shamt = (cbits(c, 12, 12) << 5) | cbits(c, 6, 2);
+    uint32_t uimm;
+    int32_t imm;
+
+    switch((c & 0x3) << 3 | funct3){
+        /*quadrant 0*/
+        case 0x00:      /*c.addi4spn*/
+            uimm = (cbits(c, 12, 11) << 4) | (cbits(c, 10, 7) << 6) |
+                   (cbits(c, 6, 6) << 2) | (cbits(c, 5, 5) << 3);
+            if(uimm == 0)
+                return 0;
+            return encI(0x13, rdp, 0x0, SPREG, uimm);
+        case 0x01:      /*c.fld*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 5) << 6);
+            return encI(0x07, rdp, 0x3, rs1p, uimm);
+        case 0x02:      /*c.lw*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 6) << 2) | (cbits(c, 5, 5) << 6);
+            return encI(0x03, rdp, 0x2, rs1p, uimm);
+        case 0x03:      /*c.ld*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 5) << 6);
+            return encI(0x03, rdp, 0x3, rs1p, uimm);
+        case 0x05:      /*c.fsd*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 5) << 6);
+            return encS(0x27, 0x3, rs1p, rdp, uimm);
+        case 0x06:      /*c.sw*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 6) << 2) | (cbits(c, 5, 5) << 6);
+            return encS(0x23, 0x2, rs1p, rdp, uimm);
+        case 0x07:      /*c.sd*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 6, 5) << 6);
+            return encS(0x23, 0x3, rs1p, rdp, uimm);
+
+        /*quadrant 1*/
+        case 0x08:      /*c.addi, c.nop*/
+            return encI(0x13, rd, 0x0, rd, imm6);
+        case 0x09:      /*c.addiw*/
+            if(rd == 0)
+                return 0;
+            return encI(0x1b, rd, 0x0, rd, imm6);
+        case 0x0a:      /*c.li*/
+            return encI(0x13, rd, 0x0, ZEROREG, imm6);
+        case 0x0b:
+            if(rd == SPREG){    /*c.addi16sp*/
+                imm = csext((cbits(c, 12, 12) << 9) | (cbits(c, 6, 6) << 4) | (cbits(c, 5, 5) << 6) |
+                            (cbits(c, 4, 3) << 7) | (cbits(c, 2, 2) << 5), 10);
+                if(imm == 0)
+                    return 0;
+                return encI(0x13, SPREG, 0x0, SPREG, imm);
+            }
+            if(imm6 == 0)       /*c.lui*/
+                return 0;
+            return ((uint32_t)imm6 << 12) | (rd << 7) | 0x37;
+        case 0x0c:
+            switch(cbits(c, 11, 10)){
+                case 0x0:       /*c.srli*/
+                    return encI(0x13, rs1p, 0x5, rs1p, shamt);
+                case 0x1:       /*c.srai*/
+                    return encI(0x13, rs1p, 0x5, rs1p, shamt | 0x400);
+                case 0x2:       /*c.andi*/
+                    return encI(0x13, rs1p, 0x7, rs1p, imm6);
+                default:
+                    if(cbits(c, 12, 12) == 0){
+                        switch(cbits(c, 6, 5)){
+                            case 0x0:   /*c.sub*/
+                                return encR(0x33, rs1p, 0x0, rs1p, rdp, 0x20);
+                            case 0x1:   /*c.xor*/
+                                return encR(0x33, rs1p, 0x4, rs1p, rdp, 0x0);
+                            case 0x2:   /*c.or*/
+                                return encR(0x33, rs1p, 0x6, rs1p, rdp, 0x0);
+                            default:    /*c.and*/
+                                return encR(0x33, rs1p, 0x7, rs1p, rdp, 0x0);
+                        }
+                    }
+                    if(cbits(c, 6, 5) == 0x0)   /*c.subw*/
+                        return encR(0x3b, rs1p, 0x0, rs1p, rdp, 0x20);
+                    if(cbits(c, 6, 5) == 0x1)   /*c.addw*/
+                        return encR(0x3b, rs1p, 0x0, rs1p, rdp, 0x0);
+                    return 0;
+            }
+        case 0x0d:      /*c.j*/
+            imm = csext((cbits(c, 12, 12) << 11) | (cbits(c, 11, 11) << 4) | (cbits(c, 10, 9) << 8) |
+                        (cbits(c, 8, 8) << 10) | (cbits(c, 7, 7) << 6) | (cbits(c, 6, 6) << 7) |
+                        (cbits(c, 5, 3) << 1) | (cbits(c, 2, 2) << 5), 12);
+            return encJ(ZEROREG, imm);
+        case 0x0e:      /*c.beqz*/
+        case 0x0f:      /*c.bnez*/
+            imm = csext((cbits(c, 12, 12) << 8) | (cbits(c, 11, 10) << 3) | (cbits(c, 6, 5) << 6) |
+                        (cbits(c, 4, 3) << 1) | (cbits(c, 2, 2) << 5), 9);
+            return encB(funct3 == 0x6 ? 0x0 : 0x1, rs1p, ZEROREG, imm);
+
+        /*quadrant 2*/
+        case 0x10:      /*c.slli*/
+            return encI(0x13, rd, 0x1, rd, shamt);
+        case 0x11:      /*c.fldsp*/
+            uimm = (cbits(c, 12, 12) << 5) | (cbits(c, 6, 5) << 3) | (cbits(c, 4, 2) << 6);
+            return encI(0x07, rd, 0x3, SPREG, uimm);
+        case 0x12:      /*c.lwsp*/
+            uimm = (cbits(c, 12, 12) << 5) | (cbits(c, 6, 4) << 2) | (cbits(c, 3, 2) << 6);
+            return encI(0x03, rd, 0x2, SPREG, uimm);
+        case 0x13:      /*c.ldsp*/
+            uimm = (cbits(c, 12, 12) << 5) | (cbits(c, 6, 5) << 3) | (cbits(c, 4, 2) << 6);
+            return encI(0x03, rd, 0x3, SPREG, uimm);
+        case 0x14:
+            if(cbits(c, 12, 12) == 0){
+                if(rs2 == 0)    /*c.jr*/
+                    return encI(0x67, ZEROREG, 0x0, rd, 0);
+                return encR(0x33, rd, 0x0, ZEROREG, rs2, 0x0);     /*c.mv*/
+            }
+            if(rd == 0 && rs2 == 0)     /*c.ebreak*/
+                return 0x00100073;
+            if(rs2 == 0)        /*c.jalr*/
+                return encI(0x67, RAREG, 0x0, rd, 0);
+            return encR(0x33, rd, 0x0, rd, rs2, 0x0);              /*c.add*/
+        case 0x15:      /*c.fsdsp*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 9, 7) << 6);
+            return encS(0x27, 0x3, SPREG, rs2, uimm);
+        case 0x16:      /*c.swsp*/
+            uimm = (cbits(c, 12, 9) << 2) | (cbits(c, 8, 7) << 6);
+            return encS(0x23, 0x2, SPREG, rs2, uimm);
+        case 0x17:      /*c.sdsp*/
+            uimm = (cbits(c, 12, 10) << 3) | (cbits(c, 9, 7) << 6);
+            return encS(0x23, 0x3, SPREG, rs2, uimm);
+        default:
+            return 0;
+    }
+}
+
+/*
+    Vector loads and stores: only unit-stride and strided, unmasked,
+    single-field forms are modelled.
+*/
+static int
+vecMemName(uint32_t ival, int unitName, int strideName){
+    int mop = (ival >> 26) & 0x3;
+    int nf = (ival >> 29) & 0x7;
+    int lumop = (ival >> 20) & 0x1f;
+
+    if(nf != 0 || (mop == 0 && lumop != 0) || mop == 1 || mop == 3){
+        printf("unsupported vector memory instr:%x\n", ival);
+        ASSERT(false);
+    }
+    return (mop == 0) ? unitName : strideName;
+}
+
+/*OP-V: vset{i}vl{i} and the integer subset, funct6 in [31:26]*/
+static int
+vecArithName(uint32_t ival){
+    uint32_t funct3 = (ival >> 12) & 0x7;
+    uint32_t funct6 = (ival >> 26) & 0x3f;
+    int name = -1;
+
+    switch(funct3){
+        case 0x7:   /*OPCFG*/
+            if(((ival >> 31) & 0x1) == 0)
+                name = IvsetVli;
+            else if(((ival >> 30) & 0x3) == 0x3)
+                name = IvsetIvli;
+            else
+                name = IvsetVl;
+            break;
+        case 0x0:   /*OPIVV*/
+            if(funct6 == 0x00)
+                name = IvaddVV;
+            else if(funct6 == 0x02)
+                name = IvsubVV;
+            else if(funct6 == 0x17)
+                name = IvmvVV;
+            break;
+        case 0x4:   /*OPIVX*/
+            if(funct6 == 0x00)
+                name = IvaddVX;
+            else if(funct6 == 0x02)
+                name = IvsubVX;
+            else if(funct6 == 0x17)
+                name = IvmvVX;
+            break;
+        case 0x3:   /*OPIVI*/
+            if(funct6 == 0x00)
+                name = IvaddVI;
+            else if(funct6 == 0x17)
+                name = IvmvVI;
+            break;
+        case 0x2:   /*OPMVV*/
+            if(funct6 == 0x00)
+                name = IvredsumVS;
+            else if(funct6 == 0x10 && ((ival >> 15) & 0x1f) == 0)
+                name = IvmvXS;
+            else if(funct6 == 0x25)
+                name = IvmulVV;
+            else if(funct6 == 0x2d)
+                name = IvmaccVV;
+            break;
+        case 0x6:   /*OPMVX*/
+            if(funct6 == 0x25)
+                name = IvmulVX;
+            else if(funct6 == 0x2d)
+                name = IvmaccVX;
+            break;
+    }
+    if(name < 0){
+        printf("unsupported vector instr:%x\n", ival);
+        ASSERT(false);
+    }
+    return name;
+}
+
+/*
+    Functional read of the instruction at virAddr for the branch
+    predictor, false when it is not on a mapped page.
+*/
+bool
+Machine::peekInstr(uint64_t virAddr, uint32_t &ival, int &len){
+    uint16_t half = 0;
+    std::map<uint64_t, pageEntry>::iterator itr = ptb.find(virAddr / PAGE_SIZE);
+    if(itr == ptb.end() || !itr->second.valid)
+        return false;
+    PhyMem.Peek(translateAddr(virAddr), 2, (char *)&half);
+    if((half & 0x3) != 0x3){
+        ival = expandCompressed(half);
+        len = 2;
+        return true;
+    }
+    ival = half;
+    itr = ptb.find((virAddr + 2) / PAGE_SIZE);
+    if(itr == ptb.end() || !itr->second.valid)
+        return false;
+    PhyMem.Peek(translateAddr(virAddr + 2), 2, (char *)&half);
+    ival |= (uint32_t)half << 16;
+    len = 4;
+    return true;
+}
+
+/*
+    The branch predictor runs ahead of Fetch: each cycle it walks one
+    fetch block from predPC, predicts every control instruction in it
+    and queues the block in the FTQ. Redirects from Execute flush the
+    queue and restart it.
+*/
+void
+Machine::PredictBlock(){
+    if(predStop)
+        return;
+    if(ftqCount == ftqEntries){
+        machineStats.ftqFull ++;
+        return;
+    }
+
+    FtqEntry &e = ftq[(ftqHead + ftqCount) % ftqEntries];
+    uint64_t pc = this->predPC;
+    uint64_t limit = (pc & ~(uint64_t)(fetchBlock - 1)) + fetchBlock;
+    bool taken = false;
+    e.start = pc;
+    e.fetched = false;
+    e.prefetchReady = 0;
+    e.slotNum = 0;
+
+    while(pc < limit && !taken){
+        uint32_t ival;
+        int len;
+        if(!peekInstr(pc, ival, len)){
+            predStop = true;
+            break;
+        }
+        FtqSlot &s = e.slots[e.slotNum ++];
+        s.instr.addr = pc;
+        s.instr.ival = ival;
+        s.instr.len = len;
+        s.predJ = false;
+        s.predMeta.kind = BrCond;
+        s.predMeta.pred = false;
+        uint64_t next = pc + len;
+
+        if(maskInstr(T_OPCODE, ival) == 0x6f){
+            /*jal*/
+            next = pc + maskInstr(T_IMMUJ, ival);
+            s.predMeta = MyPred.predict(pc, BrJal, maskInstr(T_RD, ival), 0, pc + len).meta;
+        }
+        else if(maskInstr(T_OPCODE, ival) == 0x67){
+            /*jalr: return address stack or indirect target prediction*/
+            Prediction pred = MyPred.predict(pc, BrJalr, maskInstr(T_RD, ival),
+                    maskInstr(T_RS1, ival), pc + len);
+            if(pred.hasTarget)
+                next = pred.target;
+            s.predMeta = pred.meta;
+        }
+        else if(maskInstr(T_OPCODE, ival) == 0x63){
+            /*bne beq ...*/
+            Prediction pred = MyPred.predict(pc);
+            if(pred.taken){
+                /*the BTB target, else the one pre-decoded from the instr*/
+                next = pred.hasTarget ? pred.target : pc + maskInstr(T_IMMSB, ival);
+                s.predJ = true;
+            }
+            s.predMeta = pred.meta;
+        }
+        s.predCkpt = MyPred.Checkpoint();
+
+        taken = next != pc + len;
+        pc = next;
+    }
+    if(e.slotNum == 0)
+        return;
+
+    e.bytes = (e.slots[e.slotNum - 1].instr.addr + e.slots[e.slotNum - 1].instr.len) - e.start;
+    e.next = pc;
+    this->predPC = pc;
+    ftqCount ++;
+
+    /*the lines are on their way now, Fetch waits for whatever is left of the fill*/
+    if(fdip){
+        uint64_t line = e.start & ~(uint64_t)(BLOCK_SIZE - 1);
+        for(; line < e.start + e.bytes; line += BLOCK_SIZE){
+            int time = L1I.Prefetch(translateAddr(line));
+            if(time == 0)
+                continue;
+            machineStats.fdipPrefetch ++;
+            if(machineCycle + time > e.prefetchReady)
+                e.prefetchReady = machineCycle + time;
+        }
+    }
+}
+
+/*
+    Fetch hands Decode up to issueWidth instructions of the block at the
+    FTQ head, never from two blocks in a cycle. Those Decode has no room
+    for are fetched again the next cycle, see latch().
+*/
 void
 Machine::Fetch(){
+    fetchNum = 0;
+    for(int l = 0; l < issueWidth; l++){
+        DRegO[l].bubble = true;
+        DRegO[l].stall = false;
+    }
+
     /*read instr*/
-    if(FReg.bubble){
-        DRegO.bubble = true;
-        DRegO.stall = false;
+    if(FReg.bubble)
+        return;
+    if(ftqCount == 0){
+        machineStats.ftqEmpty ++;
         return;
     }
 
-    uint64_t instrAddr = translateAddr(this->predPC);
-    Instruction instr;
-    readBytes(instrAddr, 4, &instr.ival);
-    instr.addr = this->predPC;
+    /*
+        One I-cache access per fetch block. A 32-bit instruction at the
+        end may straddle a cache line (and so a page), its upper half
+        then needs a second access.
+    */
+    FtqEntry &e = ftq[ftqHead];
+    if(!e.fetched){
+        char buf[BLOCK_SIZE];
+        uint64_t lineEnd = (e.start | (BLOCK_SIZE - 1)) + 1;
+        int first = e.bytes;
+        if(e.start + first > lineEnd)
+            first = lineEnd - e.start;
+        fetchMiss = 0;
+        e.fetchLat = readInstr(translateAddr(e.start), first, buf);
+        machineStats.fetchAccess ++;
+        if(first < e.bytes){
+            e.fetchLat += readInstr(translateAddr(lineEnd), e.bytes - first, buf);
+            machineStats.fetchAccess ++;
+            machineStats.straddleFetch ++;
+        }
+        if(e.prefetchReady > machineCycle)
+            e.fetchLat += e.prefetchReady - machineCycle;
+        e.fetchMiss = fetchMiss;
+        e.fetched = true;
+        machineStats.fetchBlocks ++;
+    }
 
     /*update PC*/
-    this->PC = this->predPC;
-
-    /*update predPC*/
-    if(maskInstr(T_OPCODE, instr.ival) == 0x6f){
-        /*jal*/
-        int64_t jalImm = maskInstr(T_IMMUJ, instr.ival);
-        this->predPC += (uint64_t)jalImm;
+    this->PC = e.slots[ftqSlot].instr.addr;
+
+    /*output signal, the I-cache time rides on the block's first instr*/
+    for(int l = 0; l < issueWidth && ftqSlot + l < e.slotNum; l++){
+        FtqSlot &s = e.slots[ftqSlot + l];
+        bool first = ftqSlot + l == 0;
+        DRegO[l].instr = s.instr;
+        DRegO[l].predJ = s.predJ;
+        DRegO[l].predMeta = s.predMeta;
+        DRegO[l].predCkpt = s.predCkpt;
+        DRegO[l].fetchLat = first ? e.fetchLat : 0;
+        DRegO[l].fetchMiss = first ? e.fetchMiss : 0;
+        DRegO[l].bubble = false;
+        DRegO[l].stall = false;
+        fetchNum ++;
     }
-    else if(maskInstr(T_OPCODE, instr.ival) == 0x63){
-        /*bne beq ...*/
-            int64_t tarPC = this->PC + maskInstr(T_IMMSB, instr.ival);
-            if(MyPred.Predict(instr.addr)){
-                this->predPC = tarPC;
-                DRegO.predJ = true;
-            }
-            else{
-                this->predPC += 4;
-                DRegO.predJ = false;
-            }
-        }
-        else
-            this->predPC += 4;
-    /*output signal*/
-    DRegO.instr = instr;
-    DRegO.bubble = false;
-    DRegO.stall = false;
 }
 
+/*Execute found a wrong prediction, everything the FTQ holds is wrong path*/
 void
-Machine::Decode(){
-    /*deal with bubble and stall*/
-    ERegO = DReg;
-    ERegO.bubble = false;
-    ERegO.stall = false;
-    if(DReg.bubble){
-        ERegO.stall = false;
-        ERegO.bubble = true;
+Machine::redirect(uint64_t pc){
+    this->predPC = pc;
+    predStop = false;
+    ftqCount = 0;
+    ftqSlot = 0;
+    fetchNum = 0;
+}
+
+/*Decode took the first n instrs Fetch handed out this cycle*/
+void
+Machine::ftqAdvance(int n){
+    if(n == 0)
         return;
+    FtqEntry &e = ftq[ftqHead];
+    for(int i = 0; i < n; i++){
+        if(e.slots[ftqSlot + i].instr.len == 2)
+            machineStats.compressedCnt ++;
+        machineStats.fetchBytes += e.slots[ftqSlot + i].instr.len;
     }
-    if(DReg.stall){
-        ERegO.stall = false;
-        ERegO.bubble = true;
+    ftqSlot += n;
+    if(ftqSlot < e.slotNum)
         return;
+    ftqSlot = 0;
+    ftqHead = (ftqHead + 1) % ftqEntries;
+    ftqCount --;
+}
+
+/*
+    Decode every lane Fetch filled, then issue them in order for as long
+    as they can go together, see canIssue(). The rest wait in DReg for
+    the next cycle. Nothing issues while an ecall is on its way to
+    Writeback, where the syscall reads and writes registers.
+*/
+void
+Machine::Decode(){
+    decodeNum = 0;
+    for(int l = 0; l < issueWidth; l++){
+        ERegO[l].bubble = true;
+        ERegO[l].stall = false;
+        forwardA[l] = false;
+        forwardB[l] = false;
+        forwardC[l] = false;
     }
+    for(int l = 0; l < issueWidth; l++)
+        if((!EReg[l].bubble && EReg[l].instr.name == Iecall) ||
+           (!MReg[l].bubble && MReg[l].instr.name == Iecall) ||
+           (!WReg[l].bubble && WReg[l].instr.name == Iecall))
+            return;
+
+    for(int l = 0; l < issueWidth && !DReg[l].bubble; l++){
+        decodeLane(l);
+        if(!canIssue(l)){
+            ERegO[l].bubble = true;
+            break;
+        }
+        decodeNum ++;
+        if(ERegO[l].instr.name == Iecall)
+            break;
+    }
+}
+
+void
+Machine::decodeLane(int l){
+    ERegO[l] = DReg[l];
+    ERegO[l].bubble = false;
+    ERegO[l].stall = false;
 
     /*decode instruction and read valA and valB from register*/
-    Instruction instr = DReg.instr;
+    Instruction instr = DReg[l].instr;
     uint32_t opcode = 0x7f & instr.ival;
     instr.opcode = opcode;
 
@@ -184,6 +648,9 @@ Machine::Decode(){
 
     int64_t funct3 = 0;
     int64_t funct7 = 0;
+    int64_t fmt = 0;
+    int64_t sC = 0;
+    int64_t vD = 0;
 
     switch(opcode){
         case 0x37:
@@ -319,6 +786,37 @@ Machine::Decode(){
         case 0x33:
             funct3 = maskInstr(T_FUNCT3, instr.ival);
             funct7 = maskInstr(T_FUNCT7, instr.ival);
+            if(funct7 == 0x1){
+                /*RV64M*/
+                switch (funct3){
+                    case 0x0:
+                        instr.name = Imul;
+                        break;
+                    case 0x1:
+                        instr.name = Imulh;
+                        break;
+                    case 0x2:
+                        instr.name = Imulhsu;
+                        break;
+                    case 0x3:
+                        instr.name = Imulhu;
+                        break;
+                    case 0x4:
+                        instr.name = Idiv;
+                        break;
+                    case 0x5:
+                        instr.name = Idivu;
+                        break;
+                    case 0x6:
+                        instr.name = Irem;
+                        break;
+                    case 0x7:
+                        instr.name = Iremu;
+                        break;
+                }
+                instr.type = R_type;
+                break;
+            }
             switch (funct3){
                 case 0x0:
                     if(funct7 == 0x0)
@@ -381,6 +879,31 @@ Machine::Decode(){
         case 0x3b:
             funct3 = maskInstr(T_FUNCT3, instr.ival);
             funct7 = maskInstr(T_FUNCT7, instr.ival);
+            if(funct7 == 0x1){
+                /*RV64M word instructions*/
+                switch (funct3){
+                    case 0x0:
+                        instr.name = Imulw;
+                        break;
+                    case 0x4:
+                        instr.name = Idivw;
+                        break;
+                    case 0x5:
+                        instr.name = Idivuw;
+                        break;
+                    case 0x6:
+                        instr.name = Iremw;
+                        break;
+                    case 0x7:
+                        instr.name = Iremuw;
+                        break;
+                    default:
+                        ASSERT(false);
+                        break;
+                }
+                instr.type = R_type;
+                break;
+            }
             switch (funct3){
                 case 0x0:
                     if(funct7 == 0x0)
@@ -404,9 +927,204 @@ Machine::Decode(){
             instr.type = R_type;
             break;
         case 0x73:
-            instr.name = Iecall;
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            switch (funct3){
+                case 0x0:
+                    instr.name = Iecall;
+                    instr.type = R_type;
+                    break;
+                case 0x1:
+                    instr.name = Icsrrw;
+                    instr.type = I_type;
+                    break;
+                case 0x2:
+                    instr.name = Icsrrs;
+                    instr.type = I_type;
+                    break;
+                case 0x3:
+                    instr.name = Icsrrc;
+                    instr.type = I_type;
+                    break;
+                case 0x5:
+                    instr.name = Icsrrwi;
+                    instr.type = I_type;
+                    break;
+                case 0x6:
+                    instr.name = Icsrrsi;
+                    instr.type = I_type;
+                    break;
+                case 0x7:
+                    instr.name = Icsrrci;
+                    instr.type = I_type;
+                    break;
+                default:
+                    ASSERT(false);
+                    break;
+            }
+            break;
+        case 0x7:
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            instr.type = I_type;
+            if(funct3 == 0x2)
+                instr.name = Iflw;
+            else if(funct3 == 0x3)
+                instr.name = Ifld;
+            else if(funct3 == 0x0 || funct3 >= 0x5){
+                /*vector load, mop in [27:26]*/
+                instr.name = vecMemName(instr.ival, Ivle, Ivlse);
+                instr.type = R_type;
+            }
+            else
+                ASSERT(false);
+            break;
+        case 0x27:
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            instr.type = S_type;
+            if(funct3 == 0x2)
+                instr.name = Ifsw;
+            else if(funct3 == 0x3)
+                instr.name = Ifsd;
+            else if(funct3 == 0x0 || funct3 >= 0x5){
+                instr.name = vecMemName(instr.ival, Ivse, Ivsse);
+                instr.type = R_type;
+            }
+            else
+                ASSERT(false);
+            break;
+        case 0x57:
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            instr.name = vecArithName(instr.ival);
+            instr.type = R_type;
+            if(instr.name == IvsetVli || instr.name == IvsetIvli)
+                instr.type = I_type;
+            break;
+        case 0x43:
+        case 0x47:
+        case 0x4b:
+        case 0x4f:
+            /*fmadd fmsub fnmsub fnmadd, fmt in funct7[1:0]*/
+            fmt = maskInstr(T_FUNCT7, instr.ival) & 0x3;
+            ASSERT(fmt <= 1);
+            instr.name = IfmaddS + ((opcode - 0x43) >> 2) * 2 + fmt;
+            instr.type = R4_type;
+            break;
+        case 0x53:
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            funct7 = maskInstr(T_FUNCT7, instr.ival);
+            fmt = funct7 & 0x3;
+            ASSERT(fmt <= 1);
+            switch (funct7 >> 2){
+                case 0x00:
+                    instr.name = IfaddS + fmt;
+                    break;
+                case 0x01:
+                    instr.name = IfsubS + fmt;
+                    break;
+                case 0x02:
+                    instr.name = IfmulS + fmt;
+                    break;
+                case 0x03:
+                    instr.name = IfdivS + fmt;
+                    break;
+                case 0x0b:
+                    instr.name = IfsqrtS + fmt;
+                    break;
+                case 0x04:
+                    ASSERT(funct3 <= 2);
+                    instr.name = IfsgnjS + funct3 * 2 + fmt;
+                    break;
+                case 0x05:
+                    ASSERT(funct3 <= 1);
+                    instr.name = IfminS + funct3 * 2 + fmt;
+                    break;
+                case 0x08:
+                    /*fmt is the destination format*/
+                    instr.name = fmt ? IfcvtDS : IfcvtSD;
+                    break;
+                case 0x14:
+                    if(funct3 == 0x2)
+                        instr.name = IfeqS + fmt;
+                    else if(funct3 == 0x1)
+                        instr.name = IfltS + fmt;
+                    else if(funct3 == 0x0)
+                        instr.name = IfleS + fmt;
+                    else
+                        ASSERT(false);
+                    break;
+                case 0x18:
+                    instr.name = IfcvtWS + maskInstr(T_RS2, instr.ival) * 2 + fmt;
+                    break;
+                case 0x1a:
+                    instr.name = IfcvtSW + maskInstr(T_RS2, instr.ival) * 2 + fmt;
+                    break;
+                case 0x1c:
+                    if(funct3 == 0x0)
+                        instr.name = IfmvXW + fmt;
+                    else if(funct3 == 0x1)
+                        instr.name = IfclassS + fmt;
+                    else
+                        ASSERT(false);
+                    break;
+                case 0x1e:
+                    instr.name = IfmvWX + fmt;
+                    break;
+                default:
+                    printf("unknown fp instr funct7:%llx\n", funct7);
+                    ASSERT(false);
+                    break;
+            }
             instr.type = R_type;
             break;
+        case 0x2f:
+            /*lr sc amo*, funct3 selects word or doubleword*/
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            ASSERT(funct3 == 0x2 || funct3 == 0x3);
+            switch ((instr.ival >> 27) & 0x1f){
+                case 0x02:
+                    instr.name = IlrW;
+                    break;
+                case 0x03:
+                    instr.name = IscW;
+                    break;
+                case 0x01:
+                    instr.name = IamoswapW;
+                    break;
+                case 0x00:
+                    instr.name = IamoaddW;
+                    break;
+                case 0x04:
+                    instr.name = IamoxorW;
+                    break;
+                case 0x0c:
+                    instr.name = IamoandW;
+                    break;
+                case 0x08:
+                    instr.name = IamoorW;
+                    break;
+                case 0x10:
+                    instr.name = IamominW;
+                    break;
+                case 0x14:
+                    instr.name = IamomaxW;
+                    break;
+                case 0x18:
+                    instr.name = IamominuW;
+                    break;
+                case 0x1c:
+                    instr.name = IamomaxuW;
+                    break;
+                default:
+                    ASSERT(false);
+                    break;
+            }
+            instr.name += funct3 - 0x2;
+            instr.type = R_type;
+            break;
+        case 0xf:
+            funct3 = maskInstr(T_FUNCT3, instr.ival);
+            instr.name = (funct3 == 0x1) ? IfenceI : Ifence;
+            instr.type = I_type;
+            break;
         case 0x0:
             instr.name = Inop;
             instr.type = R_type;
@@ -452,6 +1170,11 @@ Machine::Decode(){
         case UJ_type: 
             imm = maskInstr(T_IMMUJ, instr.ival);
             break;
+        case R4_type:
+            sA = maskInstr(T_RS1, instr.ival);
+            sB = maskInstr(T_RS2, instr.ival);
+            sC = (instr.ival >> 27) & 0x1f;
+            break;
 
         default:
             printf("unknown instruction type!\n");
@@ -463,7 +1186,8 @@ Machine::Decode(){
     int64_t dE = 0;
     int64_t dM = 0;
     if((instr.type == R_type || instr.type == I_type ||                      
-            instr.type == U_type || instr.type == UJ_type)){
+            instr.type == U_type || instr.type == UJ_type ||
+            instr.type == R4_type)){
         int64_t rd = maskInstr(T_RD, instr.ival);
         switch (instr.name){
             case Ilb:
@@ -473,6 +1197,32 @@ Machine::Decode(){
             case Ilw:
             case Ilwu:
             case Ild:
+            case Iflw:
+            case Ifld:
+                dM = rd;
+                break;
+            case IlrW:
+            case IlrD:
+            case IscW:
+            case IscD:
+            case IamoswapW:
+            case IamoswapD:
+            case IamoaddW:
+            case IamoaddD:
+            case IamoxorW:
+            case IamoxorD:
+            case IamoandW:
+            case IamoandD:
+            case IamoorW:
+            case IamoorD:
+            case IamominW:
+            case IamominD:
+            case IamomaxW:
+            case IamomaxD:
+            case IamominuW:
+            case IamominuD:
+            case IamomaxuW:
+            case IamomaxuD:
                 dM = rd;
                 break;
             default:
@@ -481,50 +1231,143 @@ Machine::Decode(){
         }
     }
 
-    if(instr.name == Iecall){
-        FReg.stall = true;
-        DRegO.bubble = true;
+    /*
+        F/D instructions name fp registers, which sit behind the integer
+        ones so that forwarding and hazard checks need no special case
+    */
+    if(instr.name >= Iflw && instr.name <= IfmvDX){
+        bool fpA = (instr.name >= IfmaddS && instr.name <= IfcvtLUD) ||
+                   (instr.name >= IfmvXW && instr.name <= IfclassD);
+        bool fpB = (instr.name >= IfmaddS && instr.name <= IfmaxD) ||
+                   (instr.name >= IfeqS && instr.name <= IfleD) ||
+                   instr.name == Ifsw || instr.name == Ifsd;
+        bool fpD = (instr.name >= IfmaddS && instr.name <= IfcvtDS) ||
+                   (instr.name >= IfcvtSW && instr.name <= IfcvtDLU) ||
+                   instr.name == IfmvWX || instr.name == IfmvDX ||
+                   instr.name == Iflw || instr.name == Ifld;
+        /*unary ops keep a selector in the rs2 field*/
+        bool useB = fpB && instr.name != IfsqrtS && instr.name != IfsqrtD;
+
+        if(fpA)
+            sA += FREG_BASE;
+        if(useB)
+            sB += FREG_BASE;
+        else if(instr.type == R_type)
+            sB = 0;
+        if(instr.type == R4_type)
+            sC += FREG_BASE;
+        if(fpD){
+            int64_t frd = maskInstr(T_RD, instr.ival) + FREG_BASE;
+            if(instr.name == Iflw || instr.name == Ifld)
+                dM = frd;
+            else
+                dE = frd;
+        }
+        vA = registers[sA];
+        vB = registers[sB];
+        vD = registers[sC];
     }
 
-    ERegO.instr = instr; 
-    ERegO.srcA = sA;
-    ERegO.srcB = sB;
-    ERegO.valA = vA;
-    ERegO.valB = vB;  
-    ERegO.dstE = dE;
-    ERegO.dstM = dM;
-    ERegO.imm = imm;
-    ERegO.stall = false;
-    ERegO.bubble = false;
+    /*
+        vector registers are read and written in MemStage, in program
+        order, so only the scalar operands take part in forwarding
+    */
+    if(instr.name >= IvsetVli && instr.name <= IvmvXS){
+        bool scalarA = instr.name == IvsetVli || instr.name == IvsetVl ||
+                       (instr.name >= Ivle && instr.name <= Ivsse) ||
+                       instr.name == IvaddVX || instr.name == IvsubVX ||
+                       instr.name == IvmulVX || instr.name == IvmaccVX ||
+                       instr.name == IvmvVX;
+        bool scalarB = instr.name == IvsetVl || instr.name == Ivlse ||
+                       instr.name == Ivsse;
+        if(!scalarA)
+            sA = 0;
+        if(!scalarB)
+            sB = 0;
+        vA = registers[sA];
+        vB = registers[sB];
+
+        dE = 0;
+        dM = 0;
+        if(instr.name <= IvsetVl)
+            dE = maskInstr(T_RD, instr.ival);
+        else if(instr.name == IvmvXS)
+            dM = maskInstr(T_RD, instr.ival);
+    }
+
+    /*csrr*i take an immediate in the rs1 field*/
+    if(instr.name >= Icsrrwi && instr.name <= Icsrrci){
+        sA = 0;
+        vA = 0;
+    }
+
+    ERegO[l].instr = instr; 
+    ERegO[l].srcA = sA;
+    ERegO[l].srcB = sB;
+    ERegO[l].srcC = sC;
+    ERegO[l].valA = vA;
+    ERegO[l].valB = vB;  
+    ERegO[l].valD = vD;
+    ERegO[l].dstE = dE;
+    ERegO[l].dstM = dM;
+    ERegO[l].imm = imm;
+    ERegO[l].stall = false;
+    ERegO[l].bubble = false;
 }
 
-void 
+/*
+    Lanes execute oldest first. One that redirects the front end takes
+    the younger ones with it, they are on the wrong path. Results are
+    forwarded once all have run, youngest first so that the newest
+    value of a register wins.
+*/
+void
 Machine::Execute(){
-    MRegO.bubble = false;
-    MRegO.stall = false;
-    if(EReg.bubble){
-        MRegO.stall = false;
-        MRegO.bubble = true;
-        return;
+    int n = 0;
+    for(int l = 0; l < issueWidth; l++){
+        MRegO[l].bubble = true;
+        MRegO[l].stall = false;
+        if(!EReg[l].bubble)
+            n ++;
     }
-    if(EReg.stall){
-        MRegO.stall = false;
-        MRegO.bubble = true;
-        return;
+    machineStats.issueHist[n] ++;
+
+    for(n = 0; n < issueWidth && !EReg[n].bubble; n++){
+        executeLane(n);
+        if(MRegO[n].mispredict){
+            n ++;
+            break;
+        }
     }
-    Instruction instr = EReg.instr;
-    int64_t sA = EReg.srcA;
-    int64_t sb = EReg.srcB;
-    int64_t vA = EReg.valA;
-    int64_t vB = EReg.valB;
-    int64_t imm = EReg.imm;
+    for(int l = n - 1; l >= 0; l--)
+        forward(MRegO[l].dstE, MRegO[l].valE, "Execute");
+}
+
+void 
+Machine::executeLane(int l){
+    Instruction instr = EReg[l].instr;
+    int64_t sA = EReg[l].srcA;
+    int64_t sb = EReg[l].srcB;
+    int64_t vA = EReg[l].valA;
+    int64_t vB = EReg[l].valB;
+    int64_t vD = EReg[l].valD;
+    int64_t imm = EReg[l].imm;
     int64_t dE = 0;
     int64_t dM = 0;
     int64_t vE = 0;
     int64_t vC = 0; /*for updating predPC*/
+    bool mispredict = false;
 
     uint32_t tmp = 0;
 
+    /*F/D: precision from the fmt field, rounding from rm or fcsr.frm*/
+    bool dbl = (instr.ival >> 25) & 0x1;
+    int rm = maskInstr(T_FUNCT3, instr.ival);
+    if(rm == RM_DYN)
+        rm = (fcsr >> 5) & 0x7;
+    uint32_t fflags = 0;
+    int64_t csrSrc = 0;
+
 
     switch(instr.name){
         case Iadd:
@@ -542,6 +1385,12 @@ Machine::Execute(){
         case Imulh:
             vE =  (int64_t)( ((__int128_t)vA * (__int128_t)vB) >> 64);
             break;
+        case Imulhsu:
+            vE = (int64_t)( ((__int128_t)vA * (__int128_t)(uint64_t)vB) >> 64);
+            break;
+        case Imulhu:
+            vE = (int64_t)( ((__uint128_t)(uint64_t)vA * (__uint128_t)(uint64_t)vB) >> 64);
+            break;
         case Islt:
             vE = (vA < vB) ? 1 : 0;
             break;
@@ -551,8 +1400,20 @@ Machine::Execute(){
         case Ixor:
             vE = vA ^ vB;
             break;
+        /*division by zero and overflow never trap in RISC-V*/
         case Idiv:
-            vE = vA / vB;
+            if(vB == 0)
+                vE = -1;
+            else if(vA == INT64_MIN && vB == -1)
+                vE = INT64_MIN;
+            else
+                vE = vA / vB;
+            break;
+        case Idivu:
+            if(vB == 0)
+                vE = -1;
+            else
+                vE = (int64_t)((uint64_t)vA / (uint64_t)vB);
             break;
         case Isrl:
             vE = (int64_t)((uint64_t)vA >> vB);
@@ -564,7 +1425,18 @@ Machine::Execute(){
             vE = vA | vB;
             break;
         case Irem:
-            vE = vA % vB;
+            if(vB == 0)
+                vE = vA;
+            else if(vA == INT64_MIN && vB == -1)
+                vE = 0;
+            else
+                vE = vA % vB;
+            break;
+        case Iremu:
+            if(vB == 0)
+                vE = vA;
+            else
+                vE = (int64_t)((uint64_t)vA % (uint64_t)vB);
             break;
         case Iand:
             vE = vA & vB;
@@ -615,17 +1487,19 @@ Machine::Execute(){
             break;
         /*jalr needs to set two bubble to wash away wrong instructions*/
         case Ijalr:                            
-            vE = instr.addr + 4;
+            vE = instr.addr + instr.len;
             vC = (vA + imm) & (-1ll ^ 0x1);
-            predPC = vC;
-            FReg.stall = false;
-            FReg.bubble = false;
-            DRegO.bubble = true;
-            DRegO.stall = false;
-            DReg.bubble = true;
-            DReg.stall = false;
-            ERegO.bubble = true;
-            ERegO.stall = false;
+            machineStats.jalrCnt ++;
+            MyPred.update(instr.addr, true, vC, EReg[l].predMeta);
+            if(EReg[l].predMeta.pred && EReg[l].predMeta.predTarget == vC){
+                /*Fetch already followed the right target*/
+                machineStats.jalrPredicted ++;
+                break;
+            }
+            MyPred.Repair(EReg[l].predCkpt);
+            redirect(vC);
+            flushYounger();
+            mispredict = true;
             machineStats.controlHazard ++;
             break;
         case Iecall:
@@ -667,7 +1541,7 @@ Machine::Execute(){
             vC = instr.addr + imm;
             break;
         case Ijal:
-            vE = instr.addr + 4;
+            vE = instr.addr + instr.len;
             break;
 
         case Isrliw:
@@ -698,6 +1572,277 @@ Machine::Execute(){
         case Israw:
             vE = (int64_t)((int32_t)vA << (int32_t)vB);
             break;
+        case Imulw:
+            vE = (int64_t)((int32_t)((uint32_t)vA * (uint32_t)vB));
+            break;
+        case Idivw:
+            if((int32_t)vB == 0)
+                vE = -1;
+            else if((int32_t)vA == INT32_MIN && (int32_t)vB == -1)
+                vE = INT32_MIN;
+            else
+                vE = (int64_t)((int32_t)vA / (int32_t)vB);
+            break;
+        case Idivuw:
+            if((uint32_t)vB == 0)
+                vE = -1;
+            else
+                vE = (int64_t)((int32_t)((uint32_t)vA / (uint32_t)vB));
+            break;
+        case Iremw:
+            if((int32_t)vB == 0)
+                vE = (int64_t)((int32_t)vA);
+            else if((int32_t)vA == INT32_MIN && (int32_t)vB == -1)
+                vE = 0;
+            else
+                vE = (int64_t)((int32_t)vA % (int32_t)vB);
+            break;
+        case Iremuw:
+            if((uint32_t)vB == 0)
+                vE = (int64_t)((int32_t)vA);
+            else
+                vE = (int64_t)((int32_t)((uint32_t)vA % (uint32_t)vB));
+            break;
+        case Iflw:
+        case Ifld:
+        case Ifsw:
+        case Ifsd:
+            vE = vA + imm;
+            break;
+        case IfmaddS:
+        case IfmaddD:
+            vE = fpArith(FpMadd, dbl, vA, vB, vD, rm, fflags);
+            break;
+        case IfmsubS:
+        case IfmsubD:
+            vE = fpArith(FpMsub, dbl, vA, vB, vD, rm, fflags);
+            break;
+        case IfnmsubS:
+        case IfnmsubD:
+            vE = fpArith(FpNmsub, dbl, vA, vB, vD, rm, fflags);
+            break;
+        case IfnmaddS:
+        case IfnmaddD:
+            vE = fpArith(FpNmadd, dbl, vA, vB, vD, rm, fflags);
+            break;
+        case IfaddS:
+        case IfaddD:
+            vE = fpArith(FpAdd, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfsubS:
+        case IfsubD:
+            vE = fpArith(FpSub, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfmulS:
+        case IfmulD:
+            vE = fpArith(FpMul, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfdivS:
+        case IfdivD:
+            vE = fpArith(FpDiv, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfsqrtS:
+        case IfsqrtD:
+            vE = fpArith(FpSqrt, dbl, vA, 0, 0, rm, fflags);
+            break;
+        case IfminS:
+        case IfminD:
+            vE = fpArith(FpMin, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfmaxS:
+        case IfmaxD:
+            vE = fpArith(FpMax, dbl, vA, vB, 0, rm, fflags);
+            break;
+        case IfsgnjS:
+        case IfsgnjD:
+            vE = fpSignInject(FpSgnj, dbl, vA, vB);
+            break;
+        case IfsgnjnS:
+        case IfsgnjnD:
+            vE = fpSignInject(FpSgnjn, dbl, vA, vB);
+            break;
+        case IfsgnjxS:
+        case IfsgnjxD:
+            vE = fpSignInject(FpSgnjx, dbl, vA, vB);
+            break;
+        case IfcvtSD:
+            vE = fpConvert(false, vA, rm, fflags);
+            break;
+        case IfcvtDS:
+            vE = fpConvert(true, vA, rm, fflags);
+            break;
+        case IfeqS:
+        case IfeqD:
+            vE = fpCompare(FpEq, dbl, vA, vB, fflags);
+            break;
+        case IfltS:
+        case IfltD:
+            vE = fpCompare(FpLt, dbl, vA, vB, fflags);
+            break;
+        case IfleS:
+        case IfleD:
+            vE = fpCompare(FpLe, dbl, vA, vB, fflags);
+            break;
+        case IfcvtWS:
+        case IfcvtWD:
+            vE = fpToInt(dbl, vA, false, true, rm, fflags);
+            break;
+        case IfcvtWUS:
+        case IfcvtWUD:
+            vE = fpToInt(dbl, vA, false, false, rm, fflags);
+            break;
+        case IfcvtLS:
+        case IfcvtLD:
+            vE = fpToInt(dbl, vA, true, true, rm, fflags);
+            break;
+        case IfcvtLUS:
+        case IfcvtLUD:
+            vE = fpToInt(dbl, vA, true, false, rm, fflags);
+            break;
+        case IfcvtSW:
+        case IfcvtDW:
+            vE = intToFp(dbl, vA, false, true, rm, fflags);
+            break;
+        case IfcvtSWU:
+        case IfcvtDWU:
+            vE = intToFp(dbl, vA, false, false, rm, fflags);
+            break;
+        case IfcvtSL:
+        case IfcvtDL:
+            vE = intToFp(dbl, vA, true, true, rm, fflags);
+            break;
+        case IfcvtSLU:
+        case IfcvtDLU:
+            vE = intToFp(dbl, vA, true, false, rm, fflags);
+            break;
+        case IfmvXW:
+            vE = (int64_t)((int32_t)vA);
+            break;
+        case IfmvXD:
+            vE = vA;
+            break;
+        case IfclassS:
+        case IfclassD:
+            vE = fpClass(dbl, vA);
+            break;
+        case IfmvWX:
+            vE = fpBoxS((uint32_t)vA);
+            break;
+        case IfmvDX:
+            vE = vA;
+            break;
+        /*csrrs/csrrc with rs1 = x0 only read*/
+        case Icsrrw:
+        case Icsrrs:
+        case Icsrrc:
+        case Icsrrwi:
+        case Icsrrsi:
+        case Icsrrci:
+            vE = readCSR(imm & 0xfff);
+            csrSrc = (instr.name >= Icsrrwi) ? maskInstr(T_RS1, instr.ival) : vA;
+            if(instr.name == Icsrrw || instr.name == Icsrrwi)
+                writeCSR(imm & 0xfff, csrSrc);
+            else if(maskInstr(T_RS1, instr.ival) != 0){
+                if(instr.name == Icsrrs || instr.name == Icsrrsi)
+                    writeCSR(imm & 0xfff, vE | csrSrc);
+                else
+                    writeCSR(imm & 0xfff, vE & ~csrSrc);
+            }
+            break;
+        /*atomics are performed in MemStage, the address is rs1*/
+        case IlrW:
+        case IlrD:
+        case IscW:
+        case IscD:
+        case IamoswapW:
+        case IamoswapD:
+        case IamoaddW:
+        case IamoaddD:
+        case IamoxorW:
+        case IamoxorD:
+        case IamoandW:
+        case IamoandD:
+        case IamoorW:
+        case IamoorD:
+        case IamominW:
+        case IamominD:
+        case IamomaxW:
+        case IamomaxD:
+        case IamominuW:
+        case IamominuD:
+        case IamomaxuW:
+        case IamomaxuD:
+            vE = vA;
+            if((instr.name - IlrW) & 0x1){
+                ASSERT((vE & 0x7) == 0)
+            }
+            else{
+                ASSERT((vE & 0x3) == 0)
+            }
+            break;
+        /*
+            Memory operations are performed in program order by the single
+            in-order MemStage, fence and the aq/rl bits need no extra work.
+        */
+        case Ifence:
+        case IfenceI:
+            break;
+        case IvsetVli:
+        case IvsetIvli:
+        case IvsetVl:{
+            /*vl and vtype change here, later vector instructions carry them on*/
+            uint64_t newType;
+            uint64_t avl;
+            int64_t rs1 = maskInstr(T_RS1, instr.ival);
+            int64_t rd = maskInstr(T_RD, instr.ival);
+
+            if(instr.name == IvsetVl)
+                newType = vB;
+            else
+                newType = imm & ((instr.name == IvsetVli) ? 0x7ff : 0x3ff);
+            uint64_t vlmax = vecVlmax(vlen, newType);
+
+            if(instr.name == IvsetIvli)
+                avl = rs1;
+            else if(rs1 != 0)
+                avl = vA;
+            else if(rd != 0)
+                avl = vlmax;
+            else
+                avl = vecVl;
+
+            if(vlmax == 0){
+                vecVtype = 1ull << 63;      /*vill*/
+                vecVl = 0;
+            }
+            else{
+                vecVtype = newType;
+                vecVl = (avl < vlmax) ? avl : vlmax;
+            }
+            vE = vecVl;
+            break;
+        }
+        case Ivle:
+        case Ivse:
+        case Ivlse:
+        case Ivsse:
+            vE = vA;
+            break;
+        case IvaddVV:
+        case IvaddVX:
+        case IvaddVI:
+        case IvsubVV:
+        case IvsubVX:
+        case IvmulVV:
+        case IvmulVX:
+        case IvmaccVV:
+        case IvmaccVX:
+        case IvredsumVS:
+        case IvmvVV:
+        case IvmvVX:
+        case IvmvVI:
+        case IvmvXS:
+            break;
         case Iauipc:
             vE = instr.addr + imm;
             break;
@@ -710,22 +1855,15 @@ Machine::Execute(){
             ASSERT(false);
             break;
     }
+    fcsr |= fflags;
 
     /*deal with wrong branch prediction*/
     if(instr.type == SB_type){
-        if(EReg.predJ != vE){
-            predPC = vE ? vC : (instr.addr + 4);
-
-            FReg.bubble = false;
-            FReg.stall = false;
-
-            DRegO.bubble = true;
-            DRegO.stall = false;
-            DReg.bubble = true;
-            DReg.stall = false;
-
-            ERegO.bubble = true;
-            ERegO.stall = false;
+        if(EReg[l].predJ != vE){
+            MyPred.Repair(EReg[l].predCkpt);
+            redirect(vE ? vC : (instr.addr + instr.len));
+            flushYounger();
+            mispredict = true;
 
             machineStats.misPrediction ++;
             machineStats.controlHazard ++;
@@ -733,96 +1871,72 @@ Machine::Execute(){
         else
             machineStats.sucPrediction ++;
 
-        MyPred.update(EReg.predJ == vE, EReg.instr.addr);
+        /*after Repair, so a mispredicted branch fixes its own history bit*/
+        MyPred.update(EReg[l].instr.addr, vE != 0, vC, EReg[l].predMeta);
     }
 
-    /*data hazard ---- fowarding*/
-    if(EReg.dstE != 0){
-        if(EReg.dstE == ERegO.srcA){
-            ERegO.valA = vE;
-            forwardA = true;
-
-            if(debug)
-                printf("Execute data forwardA:%d val:%llx\n", EReg.dstE, vE);
-
-            machineStats.dataHazard ++;
-        }
-        if(EReg.dstE == ERegO.srcB){
-            ERegO.valB = vE;
-            forwardB = true;
-
-            if(debug)
-                printf("Execute data forwardB:%d val:%llx\n", EReg.dstE, vE);
-
-            machineStats.dataHazard ++;
-        }
+    if(brTrace != NULL){
+        int rd = maskInstr(T_RD, instr.ival);
+        int rs1 = maskInstr(T_RS1, instr.ival);
+        if(instr.type == SB_type)
+            brTrace->Record(BrCond, instr.addr, vC, vE != 0, instr.len, 0, 0);
+        else if(instr.name == Ijal)
+            brTrace->Record(BrJal, instr.addr, instr.addr + maskInstr(T_IMMUJ, instr.ival),
+                            true, instr.len, rd, rs1);
+        else if(instr.name == Ijalr)
+            brTrace->Record(BrJalr, instr.addr, vC, true, instr.len, rd, rs1);
     }
 
-    /*-----------------------------------------------
-      load-use hazard 
-      can't get value needed by next instruction until phase MemStage.
-    -------------------------------------------------*/
-    if(EReg.dstM != 0 ){
-        if(ERegO.srcA == EReg.dstM || ERegO.srcB == EReg.dstM){
-            FReg.stall = true;
-            FReg.bubble = false;
+    if(instrPfm[EReg[l].instr.name] > TicksPerCycle)
+        TicksPerCycle = instrPfm[EReg[l].instr.name];
 
-            DReg.stall = true;
-            DReg.bubble = false;
-
-            ERegO.bubble = true;
-            ERegO.stall = false;
-
-            if(debug){
-                printf("\nload-use hazard\n");
-                printf("instr:%x dstM:%lld\n", instr.ival, EReg.dstM);
-            }
-
-            machineStats.loadUseHazard ++;
-        }
-    }
-
-    if(EReg.instr.name == Iecall){
-        FReg.stall = true;
-        DReg.stall = true;
-        ERegO.bubble = true;
-    }
-
-    if(instrPfm[EReg.instr.name] > TicksPerCycle)
-        TicksPerCycle = instrPfm[EReg.instr.name];
-
-    MRegO = EReg;
-    MRegO.valE = vE;
-    MRegO.valC = vC;
+    MRegO[l] = EReg[l];
+    MRegO[l].mispredict = mispredict;
+    MRegO[l].valE = vE;
+    MRegO[l].valC = vC;
+    MRegO[l].vl = vecVl;
+    MRegO[l].vtype = vecVtype;
 }
 
+/*memory is accessed in program order, results forwarded youngest first*/
 void
 Machine::MemStage(){
-    WRegO.bubble = false;
-    WRegO.stall = false;
-    if(MReg.bubble){
-        WRegO.stall = false;
-        WRegO.bubble = true;
-        return;
+    for(int l = 0; l < issueWidth; l++){
+        WRegO[l].bubble = true;
+        WRegO[l].stall = false;
     }
-    if(MReg.stall){
-        WRegO.stall = false;
-        WRegO.bubble = true;
-        return;
+    for(int l = 0; l < issueWidth && !MReg[l].bubble; l++)
+        memLane(l);
+    for(int l = issueWidth - 1; l >= 0; l--){
+        if(WRegO[l].bubble)
+            continue;
+        forward(WRegO[l].dstE, WRegO[l].valE, "MemStage");
+        forward(WRegO[l].dstM, WRegO[l].valM, "MemStage load-use");
     }
+}
 
-    Instruction instr = MReg.instr;
-    int64_t sA = MReg.srcA;
-    int64_t sb = MReg.srcB;
-    int64_t vA = MReg.valA;
-    int64_t vB = MReg.valB;
-    int64_t vE = MReg.valE;
-    int64_t imm = MReg.imm;
+void
+Machine::memLane(int l){
+    memTime = 0;
+    memMiss = 0;
+    memLevel = 0;
+    Instruction instr = MReg[l].instr;
+    int64_t sA = MReg[l].srcA;
+    int64_t sb = MReg[l].srcB;
+    int64_t vA = MReg[l].valA;
+    int64_t vB = MReg[l].valB;
+    int64_t vE = MReg[l].valE;
+    int64_t imm = MReg[l].imm;
 
     int64_t vM = 0;
     int64_t dE = 0;
     int64_t dM = 0;
 
+    int nbytes = 0;
+    uint64_t paddr = 0;
+    int64_t amoVal = 0;
+    int rmwTime = 0;
+
 
     switch(instr.name){
         case Ilb:
@@ -862,61 +1976,131 @@ Machine::MemStage(){
         case Isd:
             writeBytes(translateAddr(vE), 8, &vB);
             break;
+        case Iflw:
+            readBytes(translateAddr(vE), 4, &vM);
+            vM = fpBoxS((uint32_t)vM);
+            break;
+        case Ifld:
+            readBytes(translateAddr(vE), 8, &vM);
+            break;
+        case Ifsw:
+            writeBytes(translateAddr(vE), 4, &vB);
+            break;
+        case Ifsd:
+            writeBytes(translateAddr(vE), 8, &vB);
+            break;
+        case IlrW:
+        case IlrD:
+            nbytes = (instr.name == IlrW) ? 4 : 8;
+            paddr = translateAddr(vE);
+            readBytes(paddr, nbytes, &vM);
+            if(nbytes == 4)
+                vM = (int64_t)((int32_t)vM);
+            reservation = paddr & ~(uint64_t)(BLOCK_SIZE - 1);
+            reservationValid = true;
+            machineStats.atomicCnt ++;
+            break;
+        case IscW:
+        case IscD:
+            nbytes = (instr.name == IscW) ? 4 : 8;
+            paddr = translateAddr(vE);
+            if(reservationValid && reservation == (paddr & ~(uint64_t)(BLOCK_SIZE - 1))){
+                writeBytes(paddr, nbytes, &vB);
+                vM = 0;
+            }
+            else{
+                vM = 1;
+                machineStats.scFail ++;
+            }
+            reservationValid = false;
+            machineStats.atomicCnt ++;
+            break;
+        case IamoswapW:
+        case IamoswapD:
+        case IamoaddW:
+        case IamoaddD:
+        case IamoxorW:
+        case IamoxorD:
+        case IamoandW:
+        case IamoandD:
+        case IamoorW:
+        case IamoorD:
+        case IamominW:
+        case IamominD:
+        case IamomaxW:
+        case IamomaxD:
+        case IamominuW:
+        case IamominuD:
+        case IamomaxuW:
+        case IamomaxuD:
+            /*read-modify-write, charged as a read followed by a write*/
+            nbytes = ((instr.name - IlrW) & 0x1) ? 8 : 4;
+            paddr = translateAddr(vE);
+            rmwTime = readBytes(paddr, nbytes, &vM);
+            if(nbytes == 4){
+                vM = (int64_t)((int32_t)vM);
+                vB = (int64_t)((int32_t)vB);
+            }
+            /*W and D forms are adjacent, switch on the W form*/
+            switch(instr.name - ((instr.name - IlrW) & 0x1)){
+                case IamoswapW:
+                    amoVal = vB;
+                    break;
+                case IamoaddW:
+                    amoVal = vM + vB;
+                    break;
+                case IamoxorW:
+                    amoVal = vM ^ vB;
+                    break;
+                case IamoandW:
+                    amoVal = vM & vB;
+                    break;
+                case IamoorW:
+                    amoVal = vM | vB;
+                    break;
+                case IamominW:
+                    amoVal = (vM < vB) ? vM : vB;
+                    break;
+                case IamomaxW:
+                    amoVal = (vM > vB) ? vM : vB;
+                    break;
+                case IamominuW:
+                    amoVal = ((uint64_t)vM < (uint64_t)vB) ? vM : vB;
+                    break;
+                case IamomaxuW:
+                    amoVal = ((uint64_t)vM > (uint64_t)vB) ? vM : vB;
+                    break;
+            }
+            rmwTime += writeBytes(paddr, nbytes, &amoVal);
+            if(rmwTime > TicksPerCycle)
+                TicksPerCycle = rmwTime;
+            machineStats.atomicCnt ++;
+            break;
+        case Ivle:
+        case Ivse:
+        case Ivlse:
+        case Ivsse:
+        case IvaddVV:
+        case IvaddVX:
+        case IvaddVI:
+        case IvsubVV:
+        case IvsubVX:
+        case IvmulVV:
+        case IvmulVX:
+        case IvmaccVV:
+        case IvmaccVX:
+        case IvredsumVS:
+        case IvmvVV:
+        case IvmvVX:
+        case IvmvVI:
+        case IvmvXS:
+            vM = vectorExecute(MReg[l]);
+            break;
 
     }
 
-    /*data hazard*/
-    if(MReg.dstE != 0){
-        if(ERegO.srcA == MReg.dstE && forwardA == false){
-            ERegO.valA = vE;
-            forwardA = true;
-            if(debug)
-                printf("MemStage data forwardA:%d val:%llx\n", MReg.dstE, vE);
-
-            machineStats.dataHazard ++;
-        }
-        if(ERegO.srcB == MReg.dstE && forwardB == false){
-            ERegO.valB = vE;
-            forwardB = true;
-            if(debug)
-                printf("MemStage data forwardB:%d val:%llx\n", MReg.dstE, vE);
-
-            machineStats.dataHazard ++;
-        }
-        
-    }
-
-    /*
-        load-use hazard 
-        data forwarding
-    */
-    if(MReg.dstM != 0){
-        if(ERegO.srcA == MReg.dstM){
-            ERegO.valA = vM;
-            forwardA = true;
-            if(debug)
-                printf("MemStage load-use forwardA:%d val:%llx\n", MReg.dstM, vM);
-
-            machineStats.dataHazard ++;
-        }
-        if(ERegO.srcB == MReg.dstM){
-            ERegO.valB = vM;
-            forwardB = true;
-            if(debug)
-                printf("MemStage load-use forwardB:%d val:%llx\n", MReg.dstM, vM);
-
-            machineStats.dataHazard ++;
-        }
-    }
-
-    if(MReg.instr.name == Iecall){
-        FReg.stall = true;
-        DReg.stall = true;
-        EReg.stall = true;
-        MRegO.bubble = true;
-    }
 /*
-    switch (MReg.instr.name){
+    switch (MReg[l].instr.name){
             case Ilb:
             case Ilbu:
             case Ilh:
@@ -938,21 +2122,36 @@ Machine::MemStage(){
                 break;
         }*/
 
-    WRegO = MReg;
-    WRegO.valM = vM;
+    WRegO[l] = MReg[l];
+    WRegO[l].valM = vM;
+    WRegO[l].memLat = memTime;
+    WRegO[l].memMiss = memMiss;
+    WRegO[l].memLevel = memLevel;
 }
 
+/*registers are written in program order, results forwarded youngest first*/
 void
 Machine::Writeback(){
-    if(WReg.bubble | WReg.stall){
-        return;
+    for(int l = 0; l < issueWidth && !WReg[l].bubble; l++)
+        writebackLane(l);
+    for(int l = issueWidth - 1; l >= 0; l--){
+        if(WReg[l].bubble || WReg[l].instr.name == Iecall)
+            continue;
+        forward(WReg[l].dstE, WReg[l].valE, "Writeback");
+        forward(WReg[l].dstM, WReg[l].valM, "Writeback load-use");
     }
+}
 
-    Instruction instr = WReg.instr;   
-    int64_t vM = WReg.valM;
-    int64_t vE = WReg.valE;
-    int64_t dE = WReg.dstE;
-    int64_t dM = WReg.dstM;
+void
+Machine::writebackLane(int l){
+    Instruction instr = WReg[l].instr;   
+    int64_t vM = WReg[l].valM;
+    int64_t vE = WReg[l].valE;
+    int64_t dE = WReg[l].dstE;
+    int64_t dM = WReg[l].dstM;
+
+    retireTiming(WReg[l]);
+    machineStats.instrCnt ++;
 
     if(instr.name == Iecall){
         machineStats.ecallNum ++;
@@ -965,43 +2164,119 @@ Machine::Writeback(){
     if(dE != 0)
         registers[dE] = vE;
 
-    /*data hazard*/
-    if(dE != 0){
-        if(ERegO.srcA == dE && forwardA == false){
-            ERegO.valA = vE;
-            if(debug)
-                printf("Writeback data forwardA:%d val:%llx\n", dE, vE);
-            machineStats.dataHazard ++;
-        }
-        /*no need to set forward*/
-        if(ERegO.srcB == dE && forwardB == false){
-            ERegO.valB = vE;
-            if(debug)
-                printf("Writeback data forwardB:%d val:%llx\n", dE, vE);
-            machineStats.dataHazard ++;
-        }
-    }
-
-    /*load use hazard*/
-    if(dM != 0){
-        if(ERegO.srcA == dM && forwardA == false){
-            ERegO.valA = vM;
-            if(debug)
-                printf("Writeback load-use forwardA:%d val:%llx\n", dM, vM);
+}
 
-            machineStats.dataHazard ++;
-        }
-        if(ERegO.srcB == dM && forwardB == false){
-            ERegO.valB = vM;
-            if(debug)
-                printf("Writeback load-use forwardB:%d val:%llx\n", dM, vM);
+/*
+    Vector loads, stores and arithmetic. They run in MemStage with the
+    vl/vtype seen in Execute, so vector registers need no hazard logic.
+    Memory is accessed a cache line at a time through the hierarchy.
+*/
+int64_t
+Machine::vectorExecute(const PipReg &r){
+    Instruction instr = r.instr;
+    int vd = maskInstr(T_RD, instr.ival);       /*vs3 for stores*/
+    int vs1 = maskInstr(T_RS1, instr.ival);
+    int vs2 = maskInstr(T_RS2, instr.ival);
+    int vlenb = vlen / 8;
+    int sew = vecSew(r.vtype);
+    uint64_t vl = r.vl;
+    int64_t simm = sig64ext(4, vs1);
+    int64_t res = 0;
+    int time = 0;
+
+    if(((instr.ival >> 25) & 0x1) == 0){
+        printf("masked vector instr is not supported:%x\n", instr.ival);
+        ASSERT(false);
+    }
+    if((uint64_t)r.vtype >> 63){
+        printf("vector instr with illegal vtype:%x\n", instr.ival);
+        ASSERT(false);
+    }
+    machineStats.vecInstr ++;
 
-            machineStats.dataHazard ++;
+    switch(instr.name){
+        case Ivle:
+        case Ivse:
+        case Ivlse:
+        case Ivsse:{
+            int width = maskInstr(T_FUNCT3, instr.ival);
+            int ebytes = (width == 0) ? 1 : (1 << (width - 4));
+            bool load = (instr.name == Ivle || instr.name == Ivlse);
+            uint8_t *v = vregs + vd * vlenb;
+            ASSERT(vd * vlenb + vl * ebytes <= (uint64_t)VREG_NUM * vlenb);
+
+            if(instr.name == Ivle || instr.name == Ivse)
+                time = vectorAccess(r.valE, vl * ebytes, v, load);
+            else
+                for(uint64_t i = 0; i < vl; i++)
+                    time += vectorAccess(r.valE + i * r.valB, ebytes, v + i * ebytes, load);
+            if(time > TicksPerCycle)
+                TicksPerCycle = time;
+            return 0;
         }
+        default:
+            break;
     }
 
-    machineStats.instrCnt ++;
+    /*register groups (LMUL > 1) must not run past v31*/
+    uint64_t groupBytes = vl * sew / 8;
+    if(instr.name != IvmvXS)
+        ASSERT(vd * vlenb + groupBytes <= (uint64_t)VREG_NUM * vlenb);
+    if(instr.name != IvmvVX && instr.name != IvmvVI)
+        ASSERT(vs2 * vlenb + groupBytes <= (uint64_t)VREG_NUM * vlenb);
+    uint8_t *pd = vregs + vd * vlenb;
+    uint8_t *p1 = vregs + vs1 * vlenb;
+    uint8_t *p2 = vregs + vs2 * vlenb;
 
+    switch(instr.name){
+        case IvaddVV:
+            vecArith(VecAdd, sew, pd, p2, p1, 0, vl);
+            break;
+        case IvaddVX:
+            vecArith(VecAdd, sew, pd, p2, NULL, r.valA, vl);
+            break;
+        case IvaddVI:
+            vecArith(VecAdd, sew, pd, p2, NULL, simm, vl);
+            break;
+        case IvsubVV:
+            vecArith(VecSub, sew, pd, p2, p1, 0, vl);
+            break;
+        case IvsubVX:
+            vecArith(VecSub, sew, pd, p2, NULL, r.valA, vl);
+            break;
+        case IvmulVV:
+            vecArith(VecMul, sew, pd, p2, p1, 0, vl);
+            break;
+        case IvmulVX:
+            vecArith(VecMul, sew, pd, p2, NULL, r.valA, vl);
+            break;
+        case IvmaccVV:
+            vecArith(VecMacc, sew, pd, p2, p1, 0, vl);
+            break;
+        case IvmaccVX:
+            vecArith(VecMacc, sew, pd, p2, NULL, r.valA, vl);
+            break;
+        case IvredsumVS:
+            if(vl > 0)
+                vecSet(sew, pd, 0, vecRedSum(sew, p2, vecGet(sew, p1, 0), vl));
+            break;
+        case IvmvVV:
+            vecArith(VecMove, sew, pd, NULL, p1, 0, vl);
+            break;
+        case IvmvVX:
+            vecArith(VecMove, sew, pd, NULL, NULL, r.valA, vl);
+            break;
+        case IvmvVI:
+            vecArith(VecMove, sew, pd, NULL, NULL, simm, vl);
+            break;
+        case IvmvXS:
+            res = vecGet(sew, p2, 0);
+            break;
+        default:
+            ASSERT(false);
+            break;
+    }
+    return res;
 }
 
 void
@@ -1054,3 +2329,43 @@ Machine::syscall(){
     }
 }
 
+int64_t
+Machine::readCSR(int csr){
+    switch(csr){
+        case 0x001:     /*fflags*/
+            return fcsr & 0x1f;
+        case 0x002:     /*frm*/
+            return (fcsr >> 5) & 0x7;
+        case 0x003:     /*fcsr*/
+            return fcsr & 0xff;
+        case 0xc00:     /*cycle*/
+        case 0xc01:     /*time*/
+            return timing->Cycles();
+        case 0xc02:     /*instret*/
+            return machineStats.instrCnt;
+        default:
+            printf("unknown csr:%x\n", csr);
+            fflush(stdout);
+            ASSERT(false);
+    }
+    return 0;
+}
+
+void
+Machine::writeCSR(int csr, int64_t val){
+    switch(csr){
+        case 0x001:
+            fcsr = (fcsr & ~0x1f) | (val & 0x1f);
+            break;
+        case 0x002:
+            fcsr = (fcsr & ~0xe0) | ((val & 0x7) << 5);
+            break;
+        case 0x003:
+            fcsr = val & 0xff;
+            break;
+        default:
+            printf("csr:%x is read-only or unknown\n", csr);
+            fflush(stdout);
+            ASSERT(false);
+    }
+}
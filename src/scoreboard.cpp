@@ -0,0 +1,282 @@
+#include "scoreboard.h"
+#include "utils.h"
+#include <string.h>
+
+static const char *opClassNames[OpClassNum] = {
+    "int", "mul", "div", "fp", "fdiv", "load", "store", "vec"
+};
+
+static const char *cpiNames[CpiFieldNum] = {
+    "branch_mispredict", "icache", "load_use", "dcache_l1", "dcache_l2", "dcache_llc",
+    "ecall_serialize", "structural", "dependency"
+};
+
+int
+Scoreboard::OpClassByName(const char *name){
+    for(int i = 0; i < OpClassNum; i++)
+        if(strcmp(name, opClassNames[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char *
+Scoreboard::OpClassName(int op){
+    return opClassNames[op];
+}
+
+const char *
+Scoreboard::CpiName(int field){
+    return cpiNames[field];
+}
+
+Scoreboard::Scoreboard(){
+    loadHit = 1;
+    Init(1);
+}
+
+/*units are kept, timing and stats start over*/
+void
+Scoreboard::Init(int width, int fetchAhead){
+    ASSERT(width > 0 && fetchAhead > 0);
+    this->width = width;
+    this->fetchAhead = fetchAhead;
+    unitFree.resize(fus.size());
+    unitLevel.resize(fus.size());
+    unitHitFree.resize(fus.size());
+    for(size_t i = 0; i < fus.size(); i++){
+        unitFree[i].assign(fus[i].count, 0);
+        unitLevel[i].assign(fus[i].count, 0);
+        unitHitFree[i].assign(fus[i].count, 0);
+        fus[i].ops = 0;
+        fus[i].busy = 0;
+    }
+    for(int i = 0; i < OOO_ARCH_REGS; i++){
+        regReady[i] = 0;
+        regLevel[i] = -1;
+        regHitReady[i] = 0;
+    }
+    for(int i = 0; i < CpiFieldNum; i++)
+        cpiStall[i] = 0;
+
+    instrs = 0;
+    fetchStall = rawStall = wawStall = unitStall = serialStall = 0;
+    fetchCycle = 0;
+    fetchCnt = 0;
+    lastTaken = false;
+    redirectAt = 0;
+    redirectCause = CpiBranch;
+    lastIssue = 0;
+    issueCnt = 0;
+    lastDone = 0;
+}
+
+void
+Scoreboard::AddUnit(const char *name, int count, int latency, int ii, unsigned classes){
+    ASSERT(count > 0 && latency >= 0 && ii >= 0 && classes != 0);
+    FuncUnit f;
+    f.name = name;
+    f.count = count;
+    f.latency = latency;
+    f.ii = ii;
+    f.classes = classes;
+    f.ops = 0;
+    f.busy = 0;
+    /*a later line for the same unit replaces it*/
+    for(size_t i = 0; i < fus.size(); i++)
+        if(fus[i].name == f.name){
+            fus[i] = f;
+            unitFree[i].assign(count, 0);
+            unitLevel[i].assign(count, 0);
+            unitHitFree[i].assign(count, 0);
+            return;
+        }
+    fus.push_back(f);
+    unitFree.push_back(std::vector<uint64_t>(count, 0));
+    unitLevel.push_back(std::vector<int>(count, 0));
+    unitHitFree.push_back(std::vector<uint64_t>(count, 0));
+}
+
+void
+Scoreboard::Retire(const OooInstr &in){
+    /*front end: width per cycle, a taken jump ends the group*/
+    uint64_t f = fetchCycle;
+    if(fetchCnt == width || lastTaken){
+        f ++;
+        fetchCnt = 0;
+    }
+    uint64_t redirect = 0;
+    if(f < redirectAt){
+        redirect = redirectAt - f;
+        f = redirectAt;
+        fetchCnt = 0;
+    }
+    uint64_t icache = 0;
+    if(in.fetchLat > 1){
+        icache = in.fetchLat - 1;
+        f += icache;
+        fetchCnt = 0;
+    }
+    fetchCycle = f;
+    fetchCnt ++;
+    lastTaken = in.taken;
+
+    /*in order: never before the previous instr, width per cycle*/
+    uint64_t slot = lastIssue;
+    if(issueCnt == width)
+        slot ++;
+    uint64_t t = f + SB_FRONT;
+    if(t > slot){
+        /*the last delay added first, what is left is fetch bandwidth*/
+        uint64_t s = t - slot;
+        fetchStall += s;
+        uint64_t c = s < icache ? s : icache;
+        cpiStall[CpiICache] += c;
+        s -= c;
+        cpiStall[redirectCause] += s < redirect ? s : redirect;
+    }
+    else
+        t = slot;
+
+    /*ecall reads and writes anything, let every result land first*/
+    if(in.serialize && lastDone > t){
+        serialStall += lastDone - t;
+        cpiStall[CpiSerial] += lastDone - t;
+        t = lastDone;
+    }
+
+    uint64_t ready = t;
+    int from = 0;
+    for(int i = 0; i < 3; i++)
+        if(in.src[i] != 0 && regReady[in.src[i]] > ready){
+            ready = regReady[in.src[i]];
+            from = in.src[i];
+        }
+    if(from != 0){
+        /*a missing load costs its miss first, the rest is the load-use bubble*/
+        uint64_t s = ready - t;
+        rawStall += s;
+        if(regLevel[from] > 0){
+            uint64_t miss = regReady[from] - regHitReady[from];
+            uint64_t c = s < miss ? s : miss;
+            cpiStall[CpiDL1 + regLevel[from] - 1] += c;
+            s -= c;
+        }
+        cpiStall[regLevel[from] >= 0 ? CpiLoadUse : CpiDepend] += s;
+    }
+    t = ready;
+
+    /*earliest free unit among the kinds that handle the op*/
+    int k = -1, u = 0;
+    for(size_t i = 0; i < fus.size(); i++){
+        if(!(fus[i].classes & (1u << in.op)))
+            continue;
+        for(int j = 0; j < fus[i].count; j++)
+            if(k < 0 || unitFree[i][j] < unitFree[k][u]){
+                k = i;
+                u = j;
+            }
+    }
+    ASSERT(k >= 0);
+    FuncUnit &unit = fus[k];
+
+    /*a load result comes out of MemStage, one cycle after Execute*/
+    int exec = unit.latency;
+    if(exec == 0)
+        exec = (in.load || in.store) ? in.memLat : in.lat;
+    if(exec < 1)
+        exec = 1;
+    int lat = in.load ? 1 + exec : exec;
+    int occupy = unit.ii > 0 ? unit.ii : exec;
+
+    /*results are written in order per register*/
+    for(int i = 0; i < 2; i++)
+        if(in.dst[i] != 0 && regReady[in.dst[i]] > t + lat){
+            wawStall += regReady[in.dst[i]] - (t + lat);
+            cpiStall[CpiDepend] += regReady[in.dst[i]] - (t + lat);
+            t = regReady[in.dst[i]] - lat;
+        }
+
+    /*behind a memory op that missed, the miss is charged to its level first*/
+    if(unitFree[k][u] > t){
+        uint64_t s = unitFree[k][u] - t;
+        unitStall += s;
+        if(unitLevel[k][u] > 0){
+            uint64_t miss = unitFree[k][u] - unitHitFree[k][u];
+            uint64_t c = s < miss ? s : miss;
+            cpiStall[CpiDL1 + unitLevel[k][u] - 1] += c;
+            s -= c;
+        }
+        cpiStall[CpiStruct] += s;
+        t = unitFree[k][u];
+    }
+    bool memMissed = (in.load || in.store) && in.memLevel > 0 && unit.latency == 0 && exec > loadHit;
+    unitFree[k][u] = t + occupy;
+    unitLevel[k][u] = memMissed ? in.memLevel : 0;
+    unitHitFree[k][u] = memMissed && unit.ii == 0 ? t + (loadHit > 0 ? loadHit : 1) : t + occupy;
+    unit.ops ++;
+    unit.busy += occupy;
+
+    if(t != lastIssue){
+        lastIssue = t;
+        issueCnt = 0;
+    }
+    issueCnt ++;
+
+    /*fetch runs at most a full fetch buffer ahead of issue*/
+    if(t > fetchCycle + SB_FRONT + fetchAhead){
+        fetchCycle = t - SB_FRONT - fetchAhead;
+        fetchCnt = 0;
+    }
+
+    uint64_t done = t + lat;
+    bool missed = in.load && in.memLevel > 0 && exec > loadHit;
+    for(int i = 0; i < 2; i++)
+        if(in.dst[i] != 0){
+            regReady[in.dst[i]] = done;
+            regLevel[in.dst[i]] = in.load ? in.memLevel : -1;
+            regHitReady[in.dst[i]] = missed ? t + 1 + loadHit : done;
+        }
+    if(done > lastDone)
+        lastDone = done;
+
+    /*Execute resolves the branch, Fetch restarts the cycle after*/
+    if(in.mispredict){
+        redirectAt = t + 1;
+        redirectCause = CpiBranch;
+    }
+    if(in.serialize){
+        redirectAt = done;
+        redirectCause = CpiSerial;
+    }
+    instrs ++;
+}
+
+/*cycles until the last instruction leaves Writeback*/
+uint64_t
+Scoreboard::Cycles(){
+    return instrs > 0 ? lastDone + SB_TAIL : 0;
+}
+
+/*cycles no stall accounts for: one per issue group, the pipeline fill and drain*/
+long long
+Scoreboard::CpiBase(){
+    long long base = Cycles();
+    for(int i = 0; i < CpiFieldNum; i++)
+        base -= cpiStall[i];
+    return base;
+}
+
+void
+Scoreboard::RegisterStats(StatsRegistry &r, const std::string &prefix){
+    r.Formula(prefix + ".cycles", [this](){ return (double)Cycles(); });
+    r.Counter(prefix + ".instrs", &instrs);
+    r.Counter(prefix + ".stall.fetch", &fetchStall, "issue cycles lost to the front end");
+    r.Counter(prefix + ".stall.operand", &rawStall);
+    r.Counter(prefix + ".stall.waw", &wawStall);
+    r.Counter(prefix + ".stall.unit", &unitStall);
+    r.Counter(prefix + ".stall.serialize", &serialStall);
+    r.Formula(prefix + ".cpi_stack.base", [this](){ return (double)CpiBase(); }, "cycles");
+    for(int i = 0; i < CpiFieldNum; i++)
+        r.Counter(prefix + ".cpi_stack." + cpiNames[i], &cpiStall[i], "cycles");
+    RegisterUnits(r, prefix);
+}
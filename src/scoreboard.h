@@ -0,0 +1,77 @@
+#ifndef SCOREBOARD_H
+#define SCOREBOARD_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include "ooo.h"
+#include "stats.h"
+
+#define SB_FRONT 2          //Fetch and Decode ahead of Execute
+#define SB_TAIL 2           //MemStage and Writeback after the last result
+
+/*
+    Where issue cycles were lost, in the order of IntervalField's stalls.
+    The data cache ones are the extra latency of loads that missed that
+    level, base is whatever of Cycles() no stall explains.
+*/
+enum CpiField{
+    CpiBranch, CpiICache, CpiLoadUse, CpiDL1, CpiDL2, CpiDLLC,
+    CpiSerial, CpiStruct, CpiDepend, CpiFieldNum
+};
+
+/*
+ *In-order issue timing kept on a scoreboard. Every pipeline cycle used
+ *to be charged its slowest stage, so a miss held up unrelated work.
+ *Here an instruction issues once its operands, an issue slot and a unit
+ *of its class are free, and only what depends on a slow result or needs
+ *a busy unit waits for it. Issue times are computed directly, so idle
+ *cycles cost nothing to skip.
+ */
+class Scoreboard: public TimingModel{
+public:
+    Scoreboard();
+    void Init(int width, int fetchAhead = 8);
+    void AddUnit(const char *name, int count, int latency, int ii, unsigned classes);
+    void Retire(const OooInstr &in);
+    uint64_t Cycles();
+    uint64_t LastIssue(){ return lastIssue; }
+    void RegisterStats(StatsRegistry &r, const std::string &prefix);
+
+    static int OpClassByName(const char *name);
+    static const char *OpClassName(int op);
+    static const char *CpiName(int field);
+    long long CpiBase();
+
+    int width;
+    int fetchAhead;         /*fetch groups the fetch buffer holds ahead of Decode*/
+
+    /*stats, in cycles issue was held back*/
+    long long fetchStall;   /*front end had nothing, misses and redirects*/
+    long long rawStall;     /*waiting for an operand*/
+    long long wawStall;     /*an older write to the same register still pending*/
+    long long unitStall;    /*every unit that can take the op busy*/
+    long long serialStall;  /*ecall draining the pipeline*/
+    long long cpiStall[CpiFieldNum];    /*the same cycles by cause*/
+
+    int loadHit;            /*L1D hit time, a load taking longer missed*/
+
+private:
+    std::vector<std::vector<uint64_t> > unitFree;   /*per unit of each FuncUnit*/
+    std::vector<std::vector<int> > unitLevel;       /*memLevel of a missing memory op holding it, else 0*/
+    std::vector<std::vector<uint64_t> > unitHitFree;/*when it would be free had that op hit*/
+    uint64_t regReady[OOO_ARCH_REGS];
+    int regLevel[OOO_ARCH_REGS];        /*-1 unless written by a load, then its memLevel*/
+    uint64_t regHitReady[OOO_ARCH_REGS];/*when an L1 hit would have had it*/
+
+    uint64_t fetchCycle;
+    int fetchCnt;
+    bool lastTaken;
+    uint64_t redirectAt;
+    int redirectCause;      /*CpiBranch or CpiSerial*/
+    uint64_t lastIssue;
+    int issueCnt;
+    uint64_t lastDone;      /*latest result so far*/
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include "stats.h"
+#include "utils.h"
+#include <math.h>
+
+void
+StatsRegistry::Counter(const std::string &name, const long long *val, const char *desc){
+    StatEntry e;
+    e.name = name;
+    e.desc = desc;
+    e.kind = StatCounter;
+    e.val = val;
+    e.bins = 1;
+    entries.push_back(e);
+}
+
+void
+StatsRegistry::Formula(const std::string &name, std::function<double()> f, const char *desc){
+    StatEntry e;
+    e.name = name;
+    e.desc = desc;
+    e.kind = StatFormula;
+    e.val = NULL;
+    e.bins = 0;
+    e.formula = f;
+    entries.push_back(e);
+}
+
+void
+StatsRegistry::Histogram(const std::string &name, const long long *bins, int n, const char *desc){
+    StatEntry e;
+    e.name = name;
+    e.desc = desc;
+    e.kind = StatHistogram;
+    e.val = bins;
+    e.bins = n;
+    entries.push_back(e);
+}
+
+void
+StatsRegistry::Config(const std::string &key, const std::string &val){
+    for(size_t i = 0; i < config.size(); i++)
+        if(config[i].first == key){
+            config[i].second = val;
+            return;
+        }
+    config.push_back(std::make_pair(key, val));
+}
+
+void
+StatsRegistry::Clear(){
+    entries.clear();
+}
+
+bool
+StatsRegistry::Dump(const char *path, bool csv){
+    FILE *f = fopen(path, "w");
+    if(f == NULL){
+        printf("Fail to create stats file %s!\n", path);
+        return false;
+    }
+    if(csv)
+        dumpCsv(f);
+    else
+        dumpJson(f);
+    fclose(f);
+    return true;
+}
+
+static void
+putString(FILE *f, const std::string &s){
+    fputc('"', f);
+    for(size_t i = 0; i < s.size(); i++){
+        unsigned char c = s[i];
+        if(c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+/*CSV doubles the quotes inside a field*/
+static void
+putCsvString(FILE *f, const std::string &s){
+    fputc('"', f);
+    for(size_t i = 0; i < s.size(); i++){
+        if(s[i] == '"')
+            fputc('"', f);
+        fputc(s[i], f);
+    }
+    fputc('"', f);
+}
+
+/*JSON has no inf or nan, a formula dividing by zero dumps null*/
+static void
+putDouble(FILE *f, double v){
+    if(isnan(v) || isinf(v))
+        fprintf(f, "null");
+    else
+        fprintf(f, "%.15g", v);
+}
+
+/*entries nested by the parts of their names, children in registration order*/
+typedef struct StatNode{
+    std::string key;
+    int entry;          /*-1 for an inner node*/
+    std::vector<StatNode> children;
+}StatNode;
+
+static void
+insertNode(StatNode &root, const std::string &name, int entry){
+    StatNode *n = &root;
+    size_t start = 0;
+    while(true){
+        size_t dot = name.find('.', start);
+        std::string key = name.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+        size_t i = 0;
+        while(i < n->children.size() && n->children[i].key != key)
+            i++;
+        if(i == n->children.size()){
+            StatNode c;
+            c.key = key;
+            c.entry = -1;
+            n->children.push_back(c);
+        }
+        n = &n->children[i];
+        if(dot == std::string::npos)
+            break;
+        ASSERT(n->entry < 0);   /*a stat cannot also be a group*/
+        start = dot + 1;
+    }
+    ASSERT(n->entry < 0 && n->children.empty());
+    n->entry = entry;
+}
+
+static void
+putNode(FILE *f, const StatNode &n, const std::vector<StatEntry> &entries, int depth){
+    if(n.entry >= 0){
+        const StatEntry &e = entries[n.entry];
+        if(e.kind == StatCounter)
+            fprintf(f, "%lld", *e.val);
+        else if(e.kind == StatFormula)
+            putDouble(f, e.formula());
+        else{
+            fputc('[', f);
+            for(int i = 0; i < e.bins; i++)
+                fprintf(f, i > 0 ? ", %lld" : "%lld", e.val[i]);
+            fputc(']', f);
+        }
+        return;
+    }
+    fprintf(f, "{\n");
+    for(size_t i = 0; i < n.children.size(); i++){
+        fprintf(f, "%*s", 2 * (depth + 1), "");
+        putString(f, n.children[i].key);
+        fprintf(f, ": ");
+        putNode(f, n.children[i], entries, depth + 1);
+        fprintf(f, i + 1 < n.children.size() ? ",\n" : "\n");
+    }
+    fprintf(f, "%*s}", 2 * depth, "");
+}
+
+void
+StatsRegistry::dumpJson(FILE *f){
+    fprintf(f, "{\n  \"config\": {\n");
+    for(size_t i = 0; i < config.size(); i++){
+        fprintf(f, "    ");
+        putString(f, config[i].first);
+        fprintf(f, ": ");
+        putString(f, config[i].second);
+        fprintf(f, i + 1 < config.size() ? ",\n" : "\n");
+    }
+    fprintf(f, "  },\n  \"stats\": ");
+
+    StatNode root;
+    root.entry = -1;
+    for(size_t i = 0; i < entries.size(); i++)
+        insertNode(root, entries[i].name, i);
+    putNode(f, root, entries, 1);
+    fprintf(f, "\n}\n");
+}
+
+/*one row per value: name,value,description*/
+void
+StatsRegistry::dumpCsv(FILE *f){
+    fprintf(f, "name,value,description\n");
+    for(size_t i = 0; i < config.size(); i++){
+        fprintf(f, "config.%s,", config[i].first.c_str());
+        putCsvString(f, config[i].second);
+        fprintf(f, ",\n");
+    }
+    for(size_t i = 0; i < entries.size(); i++){
+        const StatEntry &e = entries[i];
+        if(e.kind == StatHistogram){
+            for(int b = 0; b < e.bins; b++){
+                fprintf(f, "%s[%d],%lld,", e.name.c_str(), b, e.val[b]);
+                putCsvString(f, e.desc);
+                fputc('\n', f);
+            }
+            continue;
+        }
+        fprintf(f, "%s,", e.name.c_str());
+        if(e.kind == StatCounter)
+            fprintf(f, "%lld", *e.val);
+        else
+            fprintf(f, "%.15g", e.formula());
+        fputc(',', f);
+        putCsvString(f, e.desc);
+        fputc('\n', f);
+    }
+}
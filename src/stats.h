@@ -0,0 +1,47 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+enum StatKind{
+    StatCounter, StatFormula, StatHistogram
+};
+
+typedef struct StatEntry{
+    std::string name;           /*dotted path, e.g. cache.l1d.miss_num*/
+    std::string desc;
+    StatKind kind;
+    const long long *val;       /*the counter, or the first bin*/
+    int bins;
+    std::function<double()> formula;
+}StatEntry;
+
+/*
+ *Counters, formulas and histograms registered by the parts of the
+ *machine. Entries point at the live counters and are only read when
+ *dumped. The dots in a name give the nesting of the JSON dump, CSV
+ *keeps the dotted names. The config lines that produced the run are
+ *dumped with the stats.
+ */
+class StatsRegistry{
+public:
+    void Counter(const std::string &name, const long long *val, const char *desc = "");
+    void Formula(const std::string &name, std::function<double()> f, const char *desc = "");
+    void Histogram(const std::string &name, const long long *bins, int n, const char *desc = "");
+    void Config(const std::string &key, const std::string &val);
+    void Clear();
+
+    bool Dump(const char *path, bool csv);
+
+private:
+    void dumpJson(FILE *f);
+    void dumpCsv(FILE *f);
+
+    std::vector<StatEntry> entries;
+    std::vector<std::pair<std::string, std::string> > config;  /*in file order, a repeated key keeps its last value*/
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include "stats.h"
 
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
   TypeName(const TypeName&); \
@@ -10,12 +12,12 @@
 
 // Storage access stats
 typedef struct StorageStats_ {
-  int access_counter;
-  int miss_num;
-  int access_time; // In nanoseconds
-  int replace_num; // Evict old lines
-  int fetch_num; // Fetch lower layer
-  int prefetch_num; // Prefetch
+  long long access_counter;
+  long long miss_num;
+  long long access_time; // In nanoseconds
+  long long replace_num; // Evict old lines
+  long long fetch_num; // Fetch lower layer
+  long long prefetch_num; // Prefetch
 } StorageStats;
 
 /*lantency in cpu cycles*/
@@ -27,14 +29,31 @@ typedef struct StorageLatency_ {
 
 class Storage {
  public:
-  Storage() {}
-  ~Storage() {}
+  Storage() : prefetching_(false) {}
+  virtual ~Storage() {}
 
   // Sets & Gets
   void SetStats(StorageStats ss) { stats_ = ss; }
   void GetStats(StorageStats &ss) { ss = stats_; }
+  long long GetMisses() { return stats_.miss_num; }
   void SetLatency(StorageLatency sl) { latency_ = sl; }
   void GetLatency(StorageLatency &sl) { sl = latency_; }
+  // Requests made while set fill a prefetch: counted as prefetches,
+  // kept out of the demand stats
+  void SetPrefetching(bool p) { prefetching_ = p; }
+
+  void RegisterStats(StatsRegistry &r, const std::string &prefix) {
+    r.Counter(prefix + ".accesses", &stats_.access_counter);
+    r.Counter(prefix + ".misses", &stats_.miss_num);
+    r.Counter(prefix + ".access_time", &stats_.access_time, "cycles");
+    r.Counter(prefix + ".replacements", &stats_.replace_num);
+    r.Counter(prefix + ".fetches", &stats_.fetch_num, "requests sent to the lower level");
+    r.Counter(prefix + ".prefetches", &stats_.prefetch_num);
+    const StorageStats *s = &stats_;
+    r.Formula(prefix + ".miss_rate", [s]() {
+      return s->access_counter > 0 ? (double)s->miss_num / s->access_counter : 0.0;
+    });
+  }
 
   // Main access process
   // [in]  addr: access address
@@ -49,6 +68,7 @@ class Storage {
  protected:
   StorageStats stats_;
   StorageLatency latency_;
+  bool prefetching_;
 };
 
 #endif //CACHE_STORAGE_H_ 
@@ -0,0 +1,178 @@
+#include "sweep.h"
+#include "utils.h"
+#include <thread>
+#include <atomic>
+#include <string.h>
+
+/*lower level of a swept cache, only its misses are of interest*/
+class SweepSink: public Storage{
+public:
+    void HandleRequest(uint64_t, int, int, char *, int &hit, int &time){
+        hit = 1;
+        time = 0;
+    }
+};
+
+CacheSweep::CacheSweep(){
+    accesses = 0;
+    threads = 1;
+}
+
+CacheSweep::~CacheSweep(){
+    for(size_t i = 0; i < configs.size(); i++){
+        delete configs[i].cache;
+        delete configs[i].sink;
+    }
+}
+
+void
+CacheSweep::AddConfig(const CacheConfig &cc, bool simulate){
+    SweepConfig c;
+    c.cc = cc;
+    c.family = simulate ? -2 : -1;
+    c.cache = NULL;
+    c.sink = NULL;
+    configs.push_back(c);
+}
+
+/*group the write-allocate LRU configs by set count, a Cache for the others*/
+void
+CacheSweep::Start(int threads){
+    StorageStats zero;
+    memset(&zero, 0, sizeof(zero));
+    StorageLatency none;
+    none.hit_latency = 0;
+    none.bus_latency = 0;
+
+    for(size_t i = 0; i < configs.size(); i++){
+        SweepConfig &c = configs[i];
+        if(!c.cc.write_allocate || c.family == -2){
+            c.family = -1;
+            c.sink = new SweepSink();
+            c.cache = new Cache();
+            c.cache->SetConfig(c.cc);
+            c.cache->SetLatency(none);
+            c.cache->SetStats(zero);
+            c.cache->SetLower(c.sink);
+            caches.push_back(i);
+            continue;
+        }
+        size_t k = 0;
+        while(k < families.size() && families[k].sets != c.cc.set_num)
+            k++;
+        if(k == families.size()){
+            SweepFamily f;
+            f.sets = c.cc.set_num;
+            f.depth = 0;
+            f.accesses = 0;
+            families.push_back(f);
+        }
+        if(c.cc.associativity > families[k].depth)
+            families[k].depth = c.cc.associativity;
+        c.family = k;
+    }
+    for(size_t k = 0; k < families.size(); k++){
+        SweepFamily &f = families[k];
+        f.lines.assign((size_t)f.sets * f.depth, 0);
+        f.used.assign(f.sets, 0);
+        f.hitsAt.assign(f.depth, 0);
+    }
+
+    size_t units = families.size() + caches.size();
+    this->threads = threads < 1 ? 1 : threads;
+    if(this->threads > (int)units)
+        this->threads = units > 0 ? units : 1;
+    batch.reserve(SWEEP_BATCH);
+}
+
+/*move the line to the top of its set's stack, noting how deep it was*/
+void
+CacheSweep::replayFamily(SweepFamily &f){
+    for(size_t i = 0; i < batch.size(); i++){
+        uint64_t line = batch[i].addr >> CACHE_B;
+        int set = line & (f.sets - 1);
+        uint64_t *s = &f.lines[(size_t)set * f.depth];
+        int n = f.used[set];
+        int d = 0;
+        while(d < n && s[d] != line)
+            d++;
+        if(d < n)
+            f.hitsAt[d] ++;
+        else if(n < f.depth)
+            f.used[set] = ++ n;
+        else
+            d = n - 1;              /*the LRU line drops off*/
+        memmove(s + 1, s, d * sizeof(uint64_t));
+        s[0] = line;
+    }
+    f.accesses += batch.size();
+}
+
+void
+CacheSweep::replay(size_t unit){
+    if(unit < families.size()){
+        replayFamily(families[unit]);
+        return;
+    }
+    Cache *c = configs[caches[unit - families.size()]].cache;
+    char buf[BLOCK_SIZE];
+    int hit, time;
+    for(size_t i = 0; i < batch.size(); i++)
+        c->HandleRequest(batch[i].addr, batch[i].bytes, batch[i].read, buf, hit, time);
+}
+
+/*workers take the next unreplayed family or cache until none are left*/
+void
+CacheSweep::flush(){
+    size_t units = families.size() + caches.size();
+    accesses += batch.size();
+    if(threads <= 1){
+        for(size_t u = 0; u < units; u++)
+            replay(u);
+    }
+    else{
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for(int i = 0; i < threads; i++)
+            workers.push_back(std::thread([&](){
+                for(size_t u = next ++; u < units; u = next ++)
+                    replay(u);
+            }));
+        for(size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+    batch.clear();
+}
+
+/*one row per config in the order given*/
+bool
+CacheSweep::Write(const char *path){
+    flush();
+    FILE *f = fopen(path, "w");
+    if(f == NULL){
+        printf("Fail to create sweep table %s!\n", path);
+        return false;
+    }
+    fprintf(f, "size,associativity,sets,write_through,write_allocate,engine,accesses,misses,miss_rate\n");
+    for(size_t i = 0; i < configs.size(); i++){
+        const SweepConfig &c = configs[i];
+        long long misses;
+        if(c.family >= 0){
+            const SweepFamily &fam = families[c.family];
+            misses = fam.accesses;
+            for(int d = 0; d < c.cc.associativity; d++)
+                misses -= fam.hitsAt[d];
+        }
+        else{
+            StorageStats s;
+            c.cache->GetStats(s);
+            misses = s.miss_num;
+        }
+        fprintf(f, "%d,%d,%d,%d,%d,%s,%lld,%lld,%.6f\n", c.cc.size, c.cc.associativity,
+                c.cc.set_num, c.cc.write_through, c.cc.write_allocate,
+                c.family >= 0 ? "stack" : "cache", accesses, misses,
+                accesses > 0 ? (double)misses / accesses : 0.0);
+    }
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include <vector>
+#include "cache.h"
+
+#define SWEEP_BATCH 65536       //accesses buffered before the workers replay them
+
+typedef struct SweepAccess{
+    uint64_t addr;
+    int bytes;
+    int read;
+}SweepAccess;
+
+/*LRU stacks of one set count, as deep as the widest config using it*/
+typedef struct SweepFamily{
+    int sets;
+    int depth;
+    std::vector<uint64_t> lines;    /*sets x depth, most recent first*/
+    std::vector<int> used;
+    std::vector<long long> hitsAt;  /*hits per stack depth*/
+    long long accesses;
+}SweepFamily;
+
+class SweepSink;
+
+typedef struct SweepConfig{
+    CacheConfig cc;
+    int family;                 /*stack it is read off, -1 when simulated as a Cache*/
+    Cache *cache;
+    SweepSink *sink;            /*the cache's lower level, takes anything*/
+}SweepConfig;
+
+/*
+ *Miss rates of many data cache configurations from one run, all fed
+ *the stream L1D sees. Write-allocate LRU caches are stack algorithms:
+ *configurations with the same set count (the line size is fixed) share
+ *one stack per set, a hit at depth d is a hit for every associativity
+ *above d, so a family costs one update per access whatever its size.
+ *The stacks are exact LRU, Cache only ages the other lines on a hit,
+ *so a config asked to be simulated gets a Cache of its own, and so do
+ *write-no-allocate ones, which break inclusion.
+ *Accesses are buffered and each batch is replayed with the families and
+ *caches spread over host threads, they share no state.
+ */
+class CacheSweep{
+public:
+    CacheSweep();
+    ~CacheSweep();
+    void AddConfig(const CacheConfig &cc, bool simulate);
+    void Start(int threads);
+    bool Write(const char *path);
+
+    void Access(uint64_t addr, int bytes, int read){
+        SweepAccess a;
+        a.addr = addr;
+        a.bytes = bytes;
+        a.read = read;
+        batch.push_back(a);
+        if(batch.size() == SWEEP_BATCH)
+            flush();
+    }
+
+    long long accesses;
+    std::vector<SweepConfig> configs;
+
+private:
+    void flush();
+    void replay(size_t unit);
+    void replayFamily(SweepFamily &f);
+
+    int threads;
+    std::vector<SweepFamily> families;
+    std::vector<int> caches;    /*configs simulated as a Cache*/
+    std::vector<SweepAccess> batch;
+};
+
+#endif
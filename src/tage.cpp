@@ -0,0 +1,384 @@
+#include "tage.h"
+#include "utils.h"
+#include <math.h>
+#include <string.h>
+
+#define LOOP_CONF_MAX 3
+#define LOOP_AGE_MAX 7
+#define U_RESET_PERIOD (1 << 18)    //updates between halving every useful counter
+
+static const int scHistLen[SC_TABLES] = {3, 8, 15, 27};
+
+static inline void ctrUpdate(int8_t &ctr, bool taken, int lo, int hi){
+    if(taken && ctr < hi)
+        ctr ++;
+    else if(!taken && ctr > lo)
+        ctr --;
+}
+
+void
+FoldedHis::Init(int orig, int comp){
+    val = 0;
+    origLen = orig;
+    compLen = comp;
+    outPoint = orig % comp;
+}
+
+TageSCL::TageSCL(){
+    Init(TAGE_BUDGET_KB, TAGE_TABLES);
+}
+
+/*
+    Pick the largest tagged table size that fits the budget, the bimodal
+    table gets four times as many (2-bit) entries as one tagged table.
+*/
+void
+TageSCL::Init(int budgetKB, int tables){
+    ASSERT(tables >= 2 && tables <= TAGE_MAX_TABLES);
+    ASSERT(budgetKB >= 4);
+    numTables = tables;
+
+    double ratio = (double)TAGE_MAX_HIST / TAGE_MIN_HIST;
+    for(int i = 0; i < numTables; i++){
+        histLen[i] = (int)(TAGE_MIN_HIST * pow(ratio, (double)i / (numTables - 1)) + 0.5);
+        tagBits[i] = (i < numTables / 2) ? 9 : 12;
+    }
+
+    int fixedBits = ((SC_TABLES + 1) << SC_BITS) * 6 + (1 << LOOP_BITS) * 40;
+    int entryBits = 0;
+    for(int i = 0; i < numTables; i++)
+        entryBits += 3 + 2 + tagBits[i];
+
+    int budgetBits = budgetKB * 8192;
+    logSize = 6;
+    while(logSize < 20 &&
+            fixedBits + (entryBits << (logSize + 1)) + (2 << (logSize + 3)) <= budgetBits)
+        logSize ++;
+    bimBits = logSize + 2;
+    storageBits = fixedBits + (entryBits << logSize) + (2 << bimBits);
+
+    TageEntry empty = {0, 0, 0};
+    tagged.assign((size_t)numTables << logSize, empty);
+    bimodal.assign(1 << bimBits, 2);    /*weakly taken*/
+    scTables.assign((SC_TABLES + 1) << SC_BITS, 0);
+    LoopEntry freeLoop = {0, 0, 0, 0, 0, false};
+    loops.assign(1 << LOOP_BITS, freeLoop);
+
+    memset(ghist, 0, sizeof(ghist));
+    ghead = 0;
+    pathHis = 0;
+    for(int i = 0; i < numTables; i++){
+        foldIdx[i].Init(histLen[i], logSize);
+        foldTag0[i].Init(histLen[i], tagBits[i]);
+        foldTag1[i].Init(histLen[i], tagBits[i] - 1);
+    }
+    for(int i = 0; i < SC_TABLES; i++)
+        foldSc[i].Init(scHistLen[i], SC_BITS);
+
+    useAltOnNa = 0;
+    withLoop = -1;
+    scTheta = 12;
+    scTc = 0;
+    seed = 1;
+    tick = 0;
+}
+
+bool
+TageSCL::Predict(int64_t addr, TageMeta &meta){
+    uint32_t pc = (uint32_t)(addr >> 1);
+    uint32_t mask = (1u << logSize) - 1;
+
+    /*TAGE: the longest matching history provides, the next one is the alternate*/
+    for(int i = 0; i < numTables; i++){
+        uint32_t path = pathHis & ((1u << (histLen[i] < 16 ? histLen[i] : 16)) - 1);
+        meta.idx[i] = (pc ^ (pc >> logSize) ^ foldIdx[i].val ^ path ^ (path >> logSize)) & mask;
+        meta.tag[i] = (pc ^ foldTag0[i].val ^ (foldTag1[i].val << 1)) & ((1u << tagBits[i]) - 1);
+    }
+    meta.provider = -1;
+    meta.alt = -1;
+    for(int i = numTables - 1; i >= 0; i--){
+        if(tagged[((size_t)i << logSize) + meta.idx[i]].tag != meta.tag[i])
+            continue;
+        if(meta.provider < 0)
+            meta.provider = i;
+        else{
+            meta.alt = i;
+            break;
+        }
+    }
+
+    meta.bimIdx = pc & ((1u << bimBits) - 1);
+    int8_t bim = bimodal[meta.bimIdx];
+    bool bimPred = bim >= 2;
+    meta.altPred = bimPred;
+    if(meta.alt >= 0)
+        meta.altPred = tagged[((size_t)meta.alt << logSize) + meta.idx[meta.alt]].ctr >= 0;
+
+    int conf;
+    if(meta.provider < 0){
+        meta.providerPred = bimPred;
+        meta.weak = false;
+        meta.tagePred = bimPred;
+        conf = (bim == 0 || bim == 3) ? 3 : 1;
+    }
+    else{
+        int8_t ctr = tagged[((size_t)meta.provider << logSize) + meta.idx[meta.provider]].ctr;
+        meta.providerPred = ctr >= 0;
+        meta.weak = (ctr == 0 || ctr == -1);
+        meta.tagePred = (meta.weak && useAltOnNa >= 0) ? meta.altPred : meta.providerPred;
+        conf = 2 * ctr + 1;
+        if(conf < 0)
+            conf = -conf;
+    }
+
+    /*statistical corrector: bias table plus GEHL tables on short histories*/
+    uint32_t scMask = (1u << SC_BITS) - 1;
+    meta.scIdx[0] = ((pc << 1) | meta.tagePred) & scMask;
+    for(int i = 0; i < SC_TABLES; i++)
+        meta.scIdx[i + 1] = (pc ^ (pc >> (SC_BITS - i)) ^ foldSc[i].val) & scMask;
+    int sum = 0;
+    for(int i = 0; i <= SC_TABLES; i++)
+        sum += 2 * scTables[(i << SC_BITS) + meta.scIdx[i]] + 1;
+    sum += (meta.tagePred ? 8 : -8) * conf;
+    meta.scSum = sum;
+
+    bool scPred = sum >= 0;
+    meta.scUsed = (scPred != meta.tagePred) && (sum >= scTheta || sum <= -scTheta);
+    meta.pred = meta.scUsed ? scPred : meta.tagePred;
+
+    /*a confident loop entry wins once it has proven better than the rest*/
+    if(loopPredict(addr, meta) && withLoop >= 0)
+        meta.pred = meta.loopPred;
+
+    meta.hist = Checkpoint();
+    pushHistory(addr, meta.pred);
+    return meta.pred;
+}
+
+TageHist
+TageSCL::Checkpoint(){
+    TageHist h;
+    h.ghead = ghead;
+    h.pathHis = pathHis;
+    for(int i = 0; i < numTables; i++){
+        h.fold[3 * i] = foldIdx[i].val;
+        h.fold[3 * i + 1] = foldTag0[i].val;
+        h.fold[3 * i + 2] = foldTag1[i].val;
+    }
+    for(int i = 0; i < SC_TABLES; i++)
+        h.fold[3 * TAGE_MAX_TABLES + i] = foldSc[i].val;
+    return h;
+}
+
+/*bits past ghead in the ring are simply overwritten by later pushes*/
+void
+TageSCL::Restore(const TageHist &h){
+    ghead = h.ghead;
+    pathHis = h.pathHis;
+    for(int i = 0; i < numTables; i++){
+        foldIdx[i].val = h.fold[3 * i];
+        foldTag0[i].val = h.fold[3 * i + 1];
+        foldTag1[i].val = h.fold[3 * i + 2];
+    }
+    for(int i = 0; i < SC_TABLES; i++)
+        foldSc[i].val = h.fold[3 * TAGE_MAX_TABLES + i];
+}
+
+bool
+TageSCL::loopPredict(int64_t addr, TageMeta &meta){
+    uint32_t pc = (uint32_t)(addr >> 1);
+    meta.loopIdx = pc & ((1u << LOOP_BITS) - 1);
+    meta.loopTag = (pc >> LOOP_BITS) & 0x3fff;
+    meta.loopValid = false;
+    meta.loopPred = false;
+
+    LoopEntry &e = loops[meta.loopIdx];
+    if(e.age > 0 && e.tag == meta.loopTag && e.conf == LOOP_CONF_MAX){
+        meta.loopValid = true;
+        meta.loopPred = (e.current + 1 == e.past) ? !e.dir : e.dir;
+    }
+    return meta.loopValid;
+}
+
+void
+TageSCL::loopUpdate(bool taken, const TageMeta &meta){
+    LoopEntry &e = loops[meta.loopIdx];
+
+    if(e.age > 0 && e.tag == meta.loopTag){
+        if(meta.loopValid && meta.loopPred != taken){
+            e.age = 0;
+            return;
+        }
+        if(meta.loopValid && meta.tagePred != taken && e.age < LOOP_AGE_MAX)
+            e.age ++;
+
+        e.current ++;
+        if(taken != e.dir){
+            /*loop exit: the trip count must repeat to gain confidence*/
+            if(e.current == e.past){
+                if(e.conf < LOOP_CONF_MAX)
+                    e.conf ++;
+            }
+            else{
+                e.past = e.current;
+                e.conf = 0;
+            }
+            /*short loops are left to TAGE*/
+            if(e.past < 3)
+                e.age = 0;
+            e.current = 0;
+        }
+        else if((e.past != 0 && e.current >= e.past) || e.current == 0xffff){
+            e.past = 0;
+            e.conf = 0;
+        }
+        return;
+    }
+
+    /*allocate on a TAGE misprediction, the mispredicted outcome is taken as the exit*/
+    if(meta.tagePred != taken){
+        if(e.age > 0)
+            e.age --;
+        else{
+            e.tag = meta.loopTag;
+            e.dir = !taken;
+            e.past = 0;
+            e.current = 0;
+            e.conf = 0;
+            e.age = LOOP_AGE_MAX;
+        }
+    }
+}
+
+void
+TageSCL::scUpdate(bool taken, const TageMeta &meta){
+    bool scPred = meta.scSum >= 0;
+    int mag = meta.scSum >= 0 ? meta.scSum : -meta.scSum;
+
+    if(scPred != taken || mag < scTheta)
+        for(int i = 0; i <= SC_TABLES; i++)
+            ctrUpdate(scTables[(i << SC_BITS) + meta.scIdx[i]], taken, -32, 31);
+
+    /*adapt the threshold on the cases where the corrector disagreed with TAGE*/
+    if(scPred != meta.tagePred){
+        if(scPred != taken){
+            if(++scTc >= 63){
+                scTheta ++;
+                scTc = 0;
+            }
+        }
+        else if(mag < scTheta){
+            if(--scTc <= -64){
+                if(scTheta > 4)
+                    scTheta --;
+                scTc = 0;
+            }
+        }
+    }
+}
+
+void
+TageSCL::allocate(bool taken, const TageMeta &meta){
+    int start = meta.provider + 1;
+
+    /*skip a table now and then so allocations spread over the lengths*/
+    seed = seed * 1103515245 + 12345;
+    if(((seed >> 16) & 0x1) && start < numTables - 1)
+        start ++;
+
+    for(int i = start; i < numTables; i++){
+        TageEntry &e = tagged[((size_t)i << logSize) + meta.idx[i]];
+        if(e.u == 0){
+            e.tag = meta.tag[i];
+            e.ctr = taken ? 0 : -1;
+            return;
+        }
+    }
+    for(int i = start; i < numTables; i++){
+        TageEntry &e = tagged[((size_t)i << logSize) + meta.idx[i]];
+        if(e.u > 0)
+            e.u --;
+    }
+}
+
+void
+TageSCL::pushHistory(int64_t addr, bool taken){
+    ghead = (ghead + 1) & (TAGE_HIST_BITS - 1);
+    uint64_t bit = 1ull << (ghead & 63);
+    if(taken)
+        ghist[ghead >> 6] |= bit;
+    else
+        ghist[ghead >> 6] &= ~bit;
+
+    for(int i = 0; i < numTables; i++){
+        uint32_t out = histBit(ghead - histLen[i]);
+        foldIdx[i].Update(taken, out);
+        foldTag0[i].Update(taken, out);
+        foldTag1[i].Update(taken, out);
+    }
+    for(int i = 0; i < SC_TABLES; i++)
+        foldSc[i].Update(taken, histBit(ghead - scHistLen[i]));
+
+    pathHis = ((pathHis << 1) | ((addr >> 1) & 0x1)) & 0xffff;
+}
+
+void
+TageSCL::update(int64_t addr, bool taken, const TageMeta &meta){
+    tick ++;
+
+    bool restPred = meta.scUsed ? !meta.tagePred : meta.tagePred;
+    if(meta.loopValid && meta.loopPred != restPred){
+        if(meta.loopPred == taken && withLoop < 63)
+            withLoop ++;
+        else if(meta.loopPred != taken && withLoop > -64)
+            withLoop --;
+    }
+    loopUpdate(taken, meta);
+    scUpdate(taken, meta);
+
+    /*the provider may have been replaced since the prediction*/
+    TageEntry *p = NULL;
+    if(meta.provider >= 0){
+        p = &tagged[((size_t)meta.provider << logSize) + meta.idx[meta.provider]];
+        if(p->tag != meta.tag[meta.provider])
+            p = NULL;
+    }
+
+    if(p != NULL){
+        if(meta.weak && meta.providerPred != meta.altPred){
+            if(meta.altPred == taken && useAltOnNa < 7)
+                useAltOnNa ++;
+            else if(meta.altPred != taken && useAltOnNa > -8)
+                useAltOnNa --;
+        }
+        /*a fresh entry is not trusted yet, keep training the alternate*/
+        if(p->u == 0){
+            if(meta.alt >= 0)
+                ctrUpdate(tagged[((size_t)meta.alt << logSize) + meta.idx[meta.alt]].ctr, taken, -4, 3);
+            else
+                ctrUpdate(bimodal[meta.bimIdx], taken, 0, 3);
+        }
+        ctrUpdate(p->ctr, taken, -4, 3);
+        if(meta.providerPred != meta.altPred){
+            if(meta.providerPred == taken && p->u < 3)
+                p->u ++;
+            else if(meta.providerPred != taken && p->u > 0)
+                p->u --;
+        }
+    }
+    else
+        ctrUpdate(bimodal[meta.bimIdx], taken, 0, 3);
+
+    if(meta.tagePred != taken && meta.provider < numTables - 1)
+        allocate(taken, meta);
+
+    if((tick & (U_RESET_PERIOD - 1)) == 0)
+        for(size_t i = 0; i < tagged.size(); i++)
+            tagged[i].u >>= 1;
+
+    /*the speculative push was wrong, redo it with the outcome*/
+    if(meta.pred != taken){
+        Restore(meta.hist);
+        pushHistory(addr, taken);
+    }
+}
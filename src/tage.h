@@ -0,0 +1,136 @@
+#ifndef TAGE_H
+#define TAGE_H
+
+#include <stdint.h>
+#include <vector>
+
+#define TAGE_BUDGET_KB 64       //default storage budget
+#define TAGE_TABLES 12          //default number of tagged tables
+#define TAGE_MAX_TABLES 16
+#define TAGE_MIN_HIST 4
+#define TAGE_MAX_HIST 640
+#define TAGE_HIST_BITS 1024     //global history ring, longer than TAGE_MAX_HIST
+
+#define SC_TABLES 4             //GEHL tables of the statistical corrector
+#define SC_BITS 10
+#define LOOP_BITS 6
+
+/*
+ *A history of origLen bits folded (xor) down to compLen bits.
+ *Pushing one branch costs a few shifts whatever the history length.
+ */
+class FoldedHis{
+public:
+    void Init(int orig, int comp);
+    inline void Update(uint32_t inBit, uint32_t outBit){
+        val = (val << 1) ^ inBit;
+        val ^= outBit << outPoint;
+        val ^= val >> compLen;
+        val &= (1u << compLen) - 1;
+    }
+
+    uint32_t val;
+    int origLen;
+    int compLen;
+    int outPoint;
+};
+
+/*speculative history state, restored when a branch was mispredicted*/
+typedef struct TageHist{
+    int ghead;
+    uint32_t pathHis;
+    uint32_t fold[3 * TAGE_MAX_TABLES + SC_TABLES];
+}TageHist;
+
+typedef struct TageEntry{
+    int8_t ctr;         /*3-bit signed, taken when >= 0*/
+    uint8_t u;          /*2-bit useful*/
+    uint16_t tag;
+}TageEntry;
+
+typedef struct LoopEntry{
+    uint16_t tag;
+    uint16_t past;      /*iterations before the exit*/
+    uint16_t current;
+    uint8_t conf;
+    uint8_t age;
+    bool dir;           /*direction while looping*/
+}LoopEntry;
+
+/*everything update() needs to train the entries used for a prediction*/
+typedef struct TageMeta{
+    bool pred;          /*final prediction*/
+    bool tagePred;
+    bool altPred;
+    bool providerPred;
+    bool weak;          /*provider counter is weak*/
+    int8_t provider;    /*-1: bimodal*/
+    int8_t alt;
+    bool scUsed;
+    bool loopValid;
+    bool loopPred;
+    int16_t scSum;
+    uint32_t bimIdx;
+    uint32_t loopIdx;
+    uint16_t loopTag;
+    uint32_t idx[TAGE_MAX_TABLES];
+    uint16_t tag[TAGE_MAX_TABLES];
+    uint32_t scIdx[SC_TABLES + 1];  /*bias table first*/
+    TageHist hist;      /*history before this branch was pushed*/
+}TageMeta;
+
+/*
+ *TAGE with a statistical corrector and a loop predictor (TAGE-SC-L).
+ *Table sizes are derived from a storage budget in KB.
+ *Predict() pushes the predicted direction into the history, update()
+ *repairs it when the branch turns out mispredicted.
+ */
+class TageSCL{
+public:
+    TageSCL();
+    void Init(int budgetKB, int tables);
+    bool Predict(int64_t addr, TageMeta &meta);
+    void update(int64_t addr, bool taken, const TageMeta &meta);
+    TageHist Checkpoint();
+    void Restore(const TageHist &h);
+
+    int numTables;
+    int logSize;        /*log2 entries of each tagged table*/
+    int bimBits;
+    int storageBits;
+    int histLen[TAGE_MAX_TABLES];
+    int tagBits[TAGE_MAX_TABLES];
+
+private:
+    bool loopPredict(int64_t addr, TageMeta &meta);
+    void loopUpdate(bool taken, const TageMeta &meta);
+    void scUpdate(bool taken, const TageMeta &meta);
+    void allocate(bool taken, const TageMeta &meta);
+    void pushHistory(int64_t addr, bool taken);
+    inline uint32_t histBit(int pos){
+        pos &= TAGE_HIST_BITS - 1;
+        return (ghist[pos >> 6] >> (pos & 63)) & 1;
+    }
+
+    std::vector<TageEntry> tagged;      /*numTables tables of 2^logSize*/
+    std::vector<int8_t> bimodal;
+    std::vector<int8_t> scTables;       /*(SC_TABLES + 1) x 2^SC_BITS*/
+    std::vector<LoopEntry> loops;
+
+    uint64_t ghist[TAGE_HIST_BITS / 64];
+    int ghead;
+    uint32_t pathHis;
+    FoldedHis foldIdx[TAGE_MAX_TABLES];
+    FoldedHis foldTag0[TAGE_MAX_TABLES];
+    FoldedHis foldTag1[TAGE_MAX_TABLES];
+    FoldedHis foldSc[SC_TABLES];
+
+    int useAltOnNa;     /*4-bit signed*/
+    int withLoop;       /*7-bit signed, trust in the loop predictor*/
+    int scTheta;
+    int scTc;
+    uint32_t seed;
+    uint64_t tick;      /*updates, drives the periodic useful reset*/
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "target.h"
+#include "utils.h"
+#include <math.h>
+
+#define ITTAGE_TAG_BITS 9
+
+/*the last len bits of his xor-folded down to bits*/
+static inline uint32_t foldHis(uint64_t his, int len, int bits){
+    if(len < 64)
+        his &= (1ull << len) - 1;
+    uint32_t res = 0;
+    while(his != 0){
+        res ^= (uint32_t)(his & ((1ull << bits) - 1));
+        his >>= bits;
+    }
+    return res;
+}
+
+static inline bool isLink(int reg){
+    return reg == 1 || reg == 5;
+}
+
+TargetPred::TargetPred(){
+    btbLookup = btbHit = btbCorrect = 0;
+    rasPop = rasCorrect = rasOverflow = rasUnderflow = 0;
+    ittLookup = ittHit = ittCorrect = 0;
+    ittHis = 0;
+    seed = 1;
+
+    SetBtb(BTB_BITS, BTB_WAYS);
+    SetRas(RAS_DEPTH);
+    SetIttage(ITTAGE_BITS, ITTAGE_TABLES);
+}
+
+void
+TargetPred::SetBtb(int setBits, int ways){
+    ASSERT(setBits >= 0 && setBits <= 20 && ways >= 1);
+    btbSetBits = setBits;
+    btbWays = ways;
+    BtbEntry empty = {false, 0, 0, 0};
+    btb.assign((size_t)ways << setBits, empty);
+    btbClock = 0;
+}
+
+void
+TargetPred::SetRas(int depth){
+    ASSERT(depth >= 1);
+    rasDepth = depth;
+    ras.assign(depth, 0);
+    rasTop = depth - 1;
+    rasCount = 0;
+}
+
+void
+TargetPred::SetIttage(int bits, int tables){
+    ASSERT(bits >= 1 && bits <= 20);
+    ASSERT(tables >= 1 && tables <= ITTAGE_MAX_TABLES);
+    ittBits = bits;
+    ittTables = tables;
+    IttageEntry empty = {0, 0, 0, 0};
+    itt.assign((size_t)tables << bits, empty);
+
+    /*geometric history lengths from 4 up to the whole register*/
+    double ratio = (double)ITTAGE_MAX_HIST / 4;
+    for(int i = 0; i < tables; i++)
+        ittHist[i] = (tables == 1) ? ITTAGE_MAX_HIST :
+                     (int)(4 * pow(ratio, (double)i / (tables - 1)) + 0.5);
+}
+
+/*
+    Circular stack: a push on a full stack overwrites the oldest entry,
+    so deep recursion only loses the outermost returns.
+*/
+void
+TargetPred::rasPush(int64_t val){
+    rasTop = (rasTop + 1) % rasDepth;
+    ras[rasTop] = val;
+    if(rasCount == rasDepth)
+        rasOverflow ++;
+    else
+        rasCount ++;
+}
+
+bool
+TargetPred::rasPopTop(int64_t &val){
+    if(rasCount == 0)
+        return false;
+    val = ras[rasTop];
+    rasTop = (rasTop + rasDepth - 1) % rasDepth;
+    rasCount --;
+    return true;
+}
+
+RasCheckpoint
+TargetPred::Checkpoint(){
+    RasCheckpoint cp;
+    cp.top = rasTop;
+    cp.count = rasCount;
+    cp.topVal = ras[rasTop];
+    cp.overflow = rasOverflow;
+    return cp;
+}
+
+/*
+    Restore pointer and top entry. A wrong path can only have clobbered
+    the top entry before returning to it, deeper damage is not repaired.
+*/
+void
+TargetPred::Repair(const RasCheckpoint &cp){
+    rasTop = cp.top;
+    rasCount = cp.count;
+    ras[rasTop] = cp.topVal;
+    rasOverflow = cp.overflow;
+}
+
+void
+TargetPred::FetchJal(int rd, int64_t retAddr){
+    if(isLink(rd))
+        rasPush(retAddr);
+}
+
+BtbEntry *
+TargetPred::btbFind(int64_t pc){
+    uint64_t key = (uint64_t)pc >> 1;
+    size_t set = key & ((1ull << btbSetBits) - 1);
+    uint64_t tag = key >> btbSetBits;
+    for(int w = 0; w < btbWays; w++){
+        BtbEntry &e = btb[set * btbWays + w];
+        if(e.valid && e.tag == tag)
+            return &e;
+    }
+    return NULL;
+}
+
+bool
+TargetPred::BtbLookup(int64_t pc, int64_t &target){
+    BtbEntry *e = btbFind(pc);
+    if(e == NULL)
+        return false;
+    target = e->target;
+    return true;
+}
+
+/*the BTB keeps the last target, LRU within a set*/
+void
+TargetPred::BtbInsert(int64_t pc, int64_t target){
+    BtbEntry *e = btbFind(pc);
+    if(e == NULL){
+        uint64_t key = (uint64_t)pc >> 1;
+        size_t set = key & ((1ull << btbSetBits) - 1);
+        e = &btb[set * btbWays];
+        for(int w = 1; w < btbWays; w++){
+            BtbEntry &c = btb[set * btbWays + w];
+            if(!e->valid)
+                break;
+            if(!c.valid || c.lru < e->lru)
+                e = &c;
+        }
+        e->valid = true;
+        e->tag = key >> btbSetBits;
+    }
+    e->target = target;
+    e->lru = ++ btbClock;
+}
+
+bool
+TargetPred::FetchJalr(int64_t pc, int rd, int rs1, int64_t retAddr,
+                      TargetMeta &meta, int64_t &target){
+    bool predicted = false;
+    meta.source = TgtNone;
+    meta.provider = -1;
+    meta.isReturn = isLink(rs1) && !(isLink(rd) && rs1 == rd);
+    meta.underflow = false;
+    meta.btbHit = false;
+
+    if(meta.isReturn){
+        if(rasPopTop(target)){
+            predicted = true;
+            meta.source = TgtRas;
+        }
+        else
+            meta.underflow = true;
+    }
+
+    if(!predicted){
+        /*indirect jump: the longest matching ITTAGE entry, else the BTB*/
+        uint32_t pcBits = (uint32_t)(pc >> 1);
+        for(int i = 0; i < ittTables; i++){
+            meta.idx[i] = (pcBits ^ (pcBits >> ittBits) ^ foldHis(ittHis, ittHist[i], ittBits)) &
+                          ((1u << ittBits) - 1);
+            meta.tag[i] = (pcBits ^ foldHis(ittHis, ittHist[i], ITTAGE_TAG_BITS) ^
+                           (foldHis(ittHis, ittHist[i], ITTAGE_TAG_BITS - 1) << 1)) &
+                          ((1u << ITTAGE_TAG_BITS) - 1);
+        }
+        for(int i = ittTables - 1; i >= 0; i--)
+            if(itt[((size_t)i << ittBits) + meta.idx[i]].tag == meta.tag[i]){
+                meta.provider = i;
+                break;
+            }
+
+        BtbEntry *e = btbFind(pc);
+        if(e != NULL){
+            meta.btbHit = true;
+            target = e->target;
+            predicted = true;
+            meta.source = TgtBtb;
+        }
+
+        if(meta.provider >= 0){
+            IttageEntry &ie = itt[((size_t)meta.provider << ittBits) + meta.idx[meta.provider]];
+            if(ie.conf >= 1 || !predicted){
+                target = ie.target;
+                predicted = true;
+                meta.source = TgtIttage;
+            }
+        }
+    }
+
+    if(isLink(rd))
+        rasPush(retAddr);
+    return predicted;
+}
+
+void
+TargetPred::update(int64_t pc, int64_t target, bool predicted, int64_t predTarget,
+                   const TargetMeta &meta){
+    bool correct = predicted && predTarget == target;
+
+    if(meta.isReturn){
+        rasPop ++;
+        if(meta.underflow)
+            rasUnderflow ++;
+    }
+    if(meta.source == TgtRas){
+        if(correct)
+            rasCorrect ++;
+        return;
+    }
+    btbLookup ++;
+    if(meta.btbHit)
+        btbHit ++;
+    ittLookup ++;
+    if(meta.provider >= 0)
+        ittHit ++;
+    if(correct && meta.source == TgtBtb)
+        btbCorrect ++;
+    if(correct && meta.source == TgtIttage)
+        ittCorrect ++;
+
+    BtbInsert(pc, target);
+
+    /*ITTAGE provider: confidence, then replace the target once it runs out*/
+    if(meta.provider >= 0){
+        IttageEntry &ie = itt[((size_t)meta.provider << ittBits) + meta.idx[meta.provider]];
+        if(ie.tag == meta.tag[meta.provider]){
+            if(ie.target == target){
+                if(ie.conf < 3)
+                    ie.conf ++;
+                if(meta.source == TgtIttage && ie.u < 3)
+                    ie.u ++;
+            }
+            else if(ie.conf > 0)
+                ie.conf --;
+            else
+                ie.target = target;
+        }
+    }
+
+    /*allocate on a longer history after a target misprediction*/
+    if(!correct && meta.provider < ittTables - 1){
+        int start = meta.provider + 1;
+        seed = seed * 1103515245 + 12345;
+        if(((seed >> 16) & 0x1) && start < ittTables - 1)
+            start ++;
+        bool done = false;
+        for(int i = start; i < ittTables && !done; i++){
+            IttageEntry &ie = itt[((size_t)i << ittBits) + meta.idx[i]];
+            if(ie.u == 0){
+                ie.tag = meta.tag[i];
+                ie.target = target;
+                ie.conf = 0;
+                done = true;
+            }
+        }
+        if(!done)
+            for(int i = start; i < ittTables; i++){
+                IttageEntry &ie = itt[((size_t)i << ittBits) + meta.idx[i]];
+                if(ie.u > 0)
+                    ie.u --;
+            }
+    }
+
+    ittHis = (ittHis << 2) ^ (((uint64_t)target >> 1) & 0x3);
+}
+
+void
+TargetPred::Outcome(bool taken){
+    ittHis = (ittHis << 1) | taken;
+}
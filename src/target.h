@@ -0,0 +1,108 @@
+#ifndef TARGET_H
+#define TARGET_H
+
+#include <stdint.h>
+#include <vector>
+
+#define BTB_BITS 9              //default log2 of BTB sets
+#define BTB_WAYS 2
+#define RAS_DEPTH 16
+#define ITTAGE_BITS 8           //default log2 entries of each ITTAGE table
+#define ITTAGE_TABLES 4
+#define ITTAGE_MAX_TABLES 8
+#define ITTAGE_MAX_HIST 64      //history is one 64-bit register
+
+/*enough to undo the speculative pushes and pops made after it*/
+typedef struct RasCheckpoint{
+    int top;
+    int count;
+    int64_t topVal;
+    long long overflow;     /*wrong-path pushes do not count*/
+}RasCheckpoint;
+
+typedef struct TargetMeta{
+    int8_t provider;    /*ITTAGE table, -1 when none hit*/
+    int8_t source;      /*which structure gave the target*/
+    bool isReturn;
+    bool underflow;
+    bool btbHit;
+    uint32_t idx[ITTAGE_MAX_TABLES];
+    uint16_t tag[ITTAGE_MAX_TABLES];
+}TargetMeta;
+
+enum TargetSource{
+    TgtNone, TgtRas, TgtBtb, TgtIttage
+};
+
+typedef struct BtbEntry{
+    bool valid;
+    uint64_t tag;
+    int64_t target;
+    uint64_t lru;
+}BtbEntry;
+
+typedef struct IttageEntry{
+    uint16_t tag;
+    uint8_t conf;       /*2-bit*/
+    uint8_t u;
+    int64_t target;
+}IttageEntry;
+
+/*
+ *Target prediction for jalr: a return address stack for returns, and
+ *for other indirect jumps an ITTAGE-style predictor whose base table is
+ *the BTB. Conditional branches share the BTB through BtbLookup and
+ *BtbInsert, jal targets are computed in Fetch.
+ */
+class TargetPred{
+public:
+    TargetPred();
+    void SetBtb(int setBits, int ways);
+    void SetRas(int depth);
+    void SetIttage(int bits, int tables);
+
+    /*jal/jalr seen in Fetch, returns true with target when it is predicted*/
+    void FetchJal(int rd, int64_t retAddr);
+    bool FetchJalr(int64_t pc, int rd, int rs1, int64_t retAddr,
+                   TargetMeta &meta, int64_t &target);
+    RasCheckpoint Checkpoint();
+    void Repair(const RasCheckpoint &cp);
+
+    /*resolved in Execute*/
+    void update(int64_t pc, int64_t target, bool predicted, int64_t predTarget,
+                const TargetMeta &meta);
+    void Outcome(bool taken);
+
+    bool BtbLookup(int64_t pc, int64_t &target);
+    void BtbInsert(int64_t pc, int64_t target);
+
+    /*stats, counted when the jalr resolves*/
+    long long btbLookup, btbHit, btbCorrect;
+    long long rasPop, rasCorrect, rasOverflow, rasUnderflow;
+    long long ittLookup, ittHit, ittCorrect;
+
+    int btbSetBits;
+    int btbWays;
+    int rasDepth;
+    int ittBits;
+    int ittTables;
+
+private:
+    void rasPush(int64_t val);
+    bool rasPopTop(int64_t &val);
+    BtbEntry *btbFind(int64_t pc);
+
+    std::vector<BtbEntry> btb;
+    uint64_t btbClock;
+
+    std::vector<int64_t> ras;
+    int rasTop;         /*index of the top entry*/
+    int rasCount;
+
+    std::vector<IttageEntry> itt;
+    int ittHist[ITTAGE_MAX_TABLES];
+    uint64_t ittHis;    /*branch directions and target bits*/
+    uint32_t seed;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include "stats.h"
+
+/*what a functional unit is asked to do*/
+enum OpClass{
+    OpInt, OpMul, OpDiv, OpFp, OpFdiv, OpLoad, OpStore, OpVec, OpClassNum
+};
+
+/*
+ *A kind of functional unit. latency 0 takes each instruction's own
+ *latency from the config (the cache time for loads and stores), ii 0
+ *keeps a unit busy for the whole latency.
+ */
+typedef struct FuncUnit{
+    std::string name;
+    int count;
+    int latency;
+    int ii;             /*initiation interval*/
+    unsigned classes;   /*bit per OpClass*/
+
+    /*stats*/
+    long long ops;
+    long long busy;     /*unit cycles occupied*/
+}FuncUnit;
+
+/*one committed instruction as the timing models see it*/
+typedef struct OooInstr{
+    uint64_t pc;
+    int fu;             /*FuClass*/
+    int op;             /*OpClass*/
+    int lat;            /*execute latency, loads use memLat*/
+    int src[3];         /*architectural registers, 0 when unused*/
+    int dst[2];
+    bool load;
+    bool store;
+    uint64_t addr;
+    int size;           /*0: not a candidate for forwarding*/
+    int memLat;         /*cache time seen by MemStage*/
+    int memLevel;       /*deepest data cache level missed, 0 on an L1 hit: 1 L1, 2 L2, 3 LLC*/
+    int fetchLat;       /*I-cache time when this instr opened a block*/
+    bool taken;         /*ends a fetch group*/
+    bool mispredict;
+    bool serialize;     /*ecall and csr accesses wait for older results*/
+}OooInstr;
+
+/*
+ *A timing model turns the instructions leaving Writeback into cycles.
+ *The machine hands every one to the model --core picked, and every
+ *cycle count it reports or lets the program read comes from that model.
+ */
+class TimingModel{
+public:
+    TimingModel() : instrs(0) {}
+    virtual ~TimingModel() {}
+
+    virtual void Retire(const OooInstr &in) = 0;
+    virtual uint64_t Cycles() = 0;      /*until the last instr is done*/
+    virtual uint64_t LastIssue() = 0;   /*when the last instr issued*/
+    virtual void RegisterStats(StatsRegistry &r, const std::string &prefix) = 0;
+
+    void RegisterUnits(StatsRegistry &r, const std::string &prefix){
+        for(size_t i = 0; i < fus.size(); i++){
+            const FuncUnit *f = &fus[i];
+            std::string name = prefix + ".fu." + f->name;
+            r.Counter(name + ".ops", &f->ops);
+            r.Counter(name + ".busy", &f->busy, "unit cycles occupied");
+            r.Formula(name + ".utilization", [this, f](){
+                uint64_t cap = Cycles() * f->count;
+                return cap > 0 ? (double)f->busy / cap : 0.0;
+            });
+        }
+    }
+
+    long long instrs;
+    std::vector<FuncUnit> fus;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "vector.h"
+#include "utils.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+int vecSew(uint64_t vtype){
+    return 8 << ((vtype >> 3) & 0x7);
+}
+
+uint64_t vecVlmax(int vlen, uint64_t vtype){
+    uint64_t vsew = (vtype >> 3) & 0x7;
+    uint64_t vlmul = vtype & 0x7;
+
+    /*vill, reserved bits, SEW > 64 and the reserved LMUL*/
+    if((vtype >> 8) != 0 || vsew > 3 || vlmul == 4)
+        return 0;
+
+    uint64_t elems = (uint64_t)vlen >> (3 + vsew);     /*VLEN / SEW*/
+    if(vlmul < 4)
+        return elems << vlmul;
+    return elems >> (8 - vlmul);     /*LMUL 1/8, 1/4, 1/2*/
+}
+
+int64_t vecGet(int sew, const uint8_t *v, uint64_t i){
+    int8_t b;
+    int16_t h;
+    int32_t w;
+    int64_t d;
+
+    switch(sew){
+        case 8:
+            memcpy(&b, v + i, 1);
+            return b;
+        case 16:
+            memcpy(&h, v + i * 2, 2);
+            return h;
+        case 32:
+            memcpy(&w, v + i * 4, 4);
+            return w;
+        default:
+            memcpy(&d, v + i * 8, 8);
+            return d;
+    }
+}
+
+void vecSet(int sew, uint8_t *v, uint64_t i, int64_t val){
+    memcpy(v + i * (sew / 8), &val, sew / 8);
+}
+
+#if defined(__SSE2__)
+static inline __m128i splatLanes(int sew, int64_t x){
+    switch(sew){
+        case 8:
+            return _mm_set1_epi8((char)x);
+        case 16:
+            return _mm_set1_epi16((short)x);
+        case 32:
+            return _mm_set1_epi32((int)x);
+        default:
+            return _mm_set1_epi64x(x);
+    }
+}
+
+static inline __m128i addLanes(int sew, __m128i a, __m128i b){
+    switch(sew){
+        case 8:
+            return _mm_add_epi8(a, b);
+        case 16:
+            return _mm_add_epi16(a, b);
+        case 32:
+            return _mm_add_epi32(a, b);
+        default:
+            return _mm_add_epi64(a, b);
+    }
+}
+
+static inline __m128i subLanes(int sew, __m128i a, __m128i b){
+    switch(sew){
+        case 8:
+            return _mm_sub_epi8(a, b);
+        case 16:
+            return _mm_sub_epi16(a, b);
+        case 32:
+            return _mm_sub_epi32(a, b);
+        default:
+            return _mm_sub_epi64(a, b);
+    }
+}
+
+/*SSE has no 8 or 64-bit multiply, those widths use the scalar loop*/
+static inline bool hasMulLanes(int sew){
+#if defined(__SSE4_1__)
+    return sew == 16 || sew == 32;
+#else
+    return sew == 16;
+#endif
+}
+
+static inline __m128i mulLanes(int sew, __m128i a, __m128i b){
+#if defined(__SSE4_1__)
+    if(sew == 32)
+        return _mm_mullo_epi32(a, b);
+#endif
+    return _mm_mullo_epi16(a, b);
+}
+#endif
+
+void vecArith(VecOp op, int sew, uint8_t *vd, const uint8_t *vs2,
+              const uint8_t *vs1, int64_t scalar, uint64_t vl){
+    uint64_t esize = sew / 8;
+    uint64_t bytes = vl * esize;
+    uint64_t i = 0;     /*bytes done by the SIMD loop*/
+
+    if(op == VecMove){
+        if(vs1 != NULL)
+            memmove(vd, vs1, bytes);
+        else
+            for(uint64_t e = 0; e < vl; e++)
+                vecSet(sew, vd, e, scalar);
+        return;
+    }
+
+#if defined(__SSE2__)
+    if((op != VecMul && op != VecMacc) || hasMulLanes(sew)){
+        __m128i s = splatLanes(sew, scalar);
+        for(; i + 16 <= bytes; i += 16){
+            __m128i a = _mm_loadu_si128((const __m128i *)(vs2 + i));
+            __m128i b = vs1 ? _mm_loadu_si128((const __m128i *)(vs1 + i)) : s;
+            __m128i r;
+            switch(op){
+                case VecAdd:
+                    r = addLanes(sew, a, b);
+                    break;
+                case VecSub:
+                    r = subLanes(sew, a, b);
+                    break;
+                case VecMul:
+                    r = mulLanes(sew, a, b);
+                    break;
+                default:    /*VecMacc*/
+                    r = addLanes(sew, mulLanes(sew, a, b),
+                                 _mm_loadu_si128((const __m128i *)(vd + i)));
+                    break;
+            }
+            _mm_storeu_si128((__m128i *)(vd + i), r);
+        }
+    }
+#endif
+
+    /*tail, or everything without SIMD support; wraps like the hardware*/
+    for(uint64_t e = i / esize; e < vl; e++){
+        uint64_t a = vecGet(sew, vs2, e);
+        uint64_t b = vs1 ? vecGet(sew, vs1, e) : scalar;
+        uint64_t r;
+        switch(op){
+            case VecAdd:
+                r = a + b;
+                break;
+            case VecSub:
+                r = a - b;
+                break;
+            case VecMul:
+                r = a * b;
+                break;
+            default:
+                r = a * b + (uint64_t)vecGet(sew, vd, e);
+                break;
+        }
+        vecSet(sew, vd, e, (int64_t)r);
+    }
+}
+
+int64_t vecRedSum(int sew, const uint8_t *vs2, int64_t init, uint64_t vl){
+    uint64_t esize = sew / 8;
+    uint64_t bytes = vl * esize;
+    uint64_t i = 0;
+    uint64_t sum = init;
+
+#if defined(__SSE2__)
+    /*lane-wise partial sums, wrapping addition makes the order irrelevant*/
+    __m128i acc = _mm_setzero_si128();
+    for(; i + 16 <= bytes; i += 16)
+        acc = addLanes(sew, acc, _mm_loadu_si128((const __m128i *)(vs2 + i)));
+    uint8_t lanes[16];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    for(uint64_t k = 0; k < 16 / esize; k++)
+        sum += vecGet(sew, lanes, k);
+#endif
+
+    for(uint64_t e = i / esize; e < vl; e++)
+        sum += vecGet(sew, vs2, e);
+
+    uint8_t res[8];
+    vecSet(sew, res, 0, (int64_t)sum);
+    return vecGet(sew, res, 0);
+}
@@ -0,0 +1,32 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdint.h>
+
+#define VREG_NUM 32
+#define VLEN_MAX 4096   /*bits*/
+
+enum VecOp{
+    VecAdd, VecSub, VecMul, VecMacc, VecMove
+};
+
+/*element width in bits and VLMAX for a vtype, VLMAX is 0 when vtype is illegal*/
+int vecSew(uint64_t vtype);
+uint64_t vecVlmax(int vlen, uint64_t vtype);
+
+/*
+ *Lane kernels over vl elements of sew bits.
+ *vs1 == NULL means the scalar operand is used for every element.
+ *VecMacc accumulates into vd, VecMove copies vs1 (or the scalar).
+ */
+void vecArith(VecOp op, int sew, uint8_t *vd, const uint8_t *vs2,
+              const uint8_t *vs1, int64_t scalar, uint64_t vl);
+
+/*init + sum of vs2[0..vl), wrapped to sew bits*/
+int64_t vecRedSum(int sew, const uint8_t *vs2, int64_t init, uint64_t vl);
+
+/*read and write one element, reads are sign extended*/
+int64_t vecGet(int sew, const uint8_t *v, uint64_t i);
+void vecSet(int sew, uint8_t *v, uint64_t i, int64_t val);
+
+#endif